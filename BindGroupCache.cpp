@@ -0,0 +1,129 @@
+#include "BindGroupCache.h"
+#include "Hash.h"
+
+using namespace wgpu;
+
+namespace {
+template <typename T>
+void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Field by field, the entry struct has padding
+void serialize(const BindGroupDescriptor& descriptor, std::string& out) {
+    append(out, descriptor.layout);
+    for (uint32_t i = 0; i < descriptor.entryCount; i++) {
+        const WGPUBindGroupEntry& entry = descriptor.entries[i];
+        append(out, entry.binding);
+        append(out, entry.buffer);
+        append(out, entry.offset);
+        append(out, entry.size);
+        append(out, entry.sampler);
+        append(out, entry.textureView);
+    }
+}
+} // namespace
+
+BindGroupCache::BindGroupCache(Fence& fence, uint32_t maxIdleFrames)
+    : m_fence(fence), m_device(fence.getDevice()), m_maxIdleFrames(maxIdleFrames) {
+    m_scratch.reserve(256);
+}
+
+BindGroupCache::~BindGroupCache() {
+    for (uint32_t i = 0; i < (uint32_t)m_groups.size(); i++) {
+        if (m_groups[i].bindGroup) evict(i);
+    }
+}
+
+void BindGroupCache::beginFrame() {
+    m_frame++;
+    for (uint32_t i = 0; i < (uint32_t)m_groups.size(); i++) {
+        if (m_groups[i].bindGroup && m_frame - m_groups[i].lastFrame > m_maxIdleFrames) evict(i);
+    }
+}
+
+BindGroup BindGroupCache::get(const BindGroupDescriptor& descriptor) {
+    m_scratch.clear();
+    serialize(descriptor, m_scratch);
+    uint64_t hash = hashBytes(m_scratch.data(), m_scratch.size());
+    auto range = m_byHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        Group& group = m_groups[it->second];
+        if (group.key != m_scratch) continue;
+        group.lastFrame = m_frame;
+        group.lastSubmission = m_fence.lastSignaled() + 1;
+        m_stats.hits++;
+        return group.bindGroup;
+    }
+
+    uint32_t index;
+    if (!m_unusedGroups.empty()) {
+        index = m_unusedGroups.back();
+        m_unusedGroups.pop_back();
+    } else {
+        index = (uint32_t)m_groups.size();
+        m_groups.emplace_back();
+    }
+    Group& group = m_groups[index];
+    group.bindGroup = m_device.createBindGroup(descriptor);
+    group.layout = descriptor.layout;
+    group.entries.assign(descriptor.entries, descriptor.entries + descriptor.entryCount);
+    group.key = m_scratch;
+    group.lastFrame = m_frame;
+    group.lastSubmission = m_fence.lastSignaled() + 1;
+    m_byHash.emplace(hash, index);
+
+    BindGroupLayout(group.layout).reference();
+    for (WGPUBindGroupEntry& entry : group.entries) {
+        entry.nextInChain = nullptr;
+        if (entry.buffer) Buffer(entry.buffer).reference();
+        if (entry.sampler) Sampler(entry.sampler).reference();
+        if (entry.textureView) TextureView(entry.textureView).reference();
+        void* resource = entry.buffer ? (void*)entry.buffer : entry.sampler ? (void*)entry.sampler : (void*)entry.textureView;
+        if (resource) m_byResource.emplace(resource, index);
+    }
+    m_stats.created++;
+    m_stats.live++;
+    return group.bindGroup;
+}
+
+void BindGroupCache::invalidate(void* resource) {
+    auto range = m_byResource.equal_range(resource);
+    std::vector<uint32_t> groups;
+    for (auto it = range.first; it != range.second; ++it) groups.push_back(it->second);
+    for (uint32_t group : groups) {
+        if (m_groups[group].bindGroup) evict(group); // A group may reference the resource twice
+    }
+}
+
+void BindGroupCache::evict(uint32_t index) {
+    Group& group = m_groups[index];
+    auto range = m_byHash.equal_range(hashBytes(group.key.data(), group.key.size()));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second != index) continue;
+        m_byHash.erase(it);
+        break;
+    }
+    for (const WGPUBindGroupEntry& entry : group.entries) {
+        void* resource = entry.buffer ? (void*)entry.buffer : entry.sampler ? (void*)entry.sampler : (void*)entry.textureView;
+        auto resources = m_byResource.equal_range(resource);
+        for (auto it = resources.first; it != resources.second; ++it) {
+            if (it->second != index) continue;
+            m_byResource.erase(it);
+            break;
+        }
+        // The group holds its own references, these are only the key's
+        if (entry.buffer) Buffer(entry.buffer).release();
+        if (entry.sampler) Sampler(entry.sampler).release();
+        if (entry.textureView) TextureView(entry.textureView).release();
+    }
+    BindGroupLayout(group.layout).release();
+
+    m_fence.releaseAfter(group.lastSubmission, group.bindGroup);
+    group.bindGroup = nullptr;
+    group.entries.clear();
+    group.key.clear();
+    m_unusedGroups.push_back(index);
+    m_stats.evicted++;
+    m_stats.live--;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+// Reuses bind groups across draws and frames instead of creating them per draw.
+//
+// Groups are keyed by their layout and entries (binding, buffer range, sampler, texture view).
+// The cache keeps references to everything in its keys, so that a new object reusing the
+// address of a released one can never hit a stale group. WebGPU does not report destruction,
+// so resources that are destroyed while still cached should be passed to invalidate(), which
+// drops their groups right away: BufferAllocator and RenderTargetPool do it for their buffers
+// and textures once given the cache. The others are released once unused for maxIdleFrames
+// frames.
+// Groups are released after the last submission that may use them has retired.
+class BindGroupCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t created = 0;
+        uint64_t evicted = 0; // Idle or invalidated
+        uint32_t live = 0;
+    };
+
+    BindGroupCache(wgpu::Fence& fence, uint32_t maxIdleFrames = 8);
+    ~BindGroupCache();
+    BindGroupCache(const BindGroupCache&) = delete;
+    BindGroupCache& operator=(const BindGroupCache&) = delete;
+
+    // Evicts the groups that went unused for too long
+    void beginFrame();
+    // Owned by the cache, valid until the end of the frame at least
+    wgpu::BindGroup get(const wgpu::BindGroupDescriptor& descriptor);
+
+    void invalidate(wgpu::Buffer buffer) { invalidate(static_cast<void*>(static_cast<WGPUBuffer>(buffer))); }
+    void invalidate(wgpu::TextureView view) { invalidate(static_cast<void*>(static_cast<WGPUTextureView>(view))); }
+    void invalidate(wgpu::Sampler sampler) { invalidate(static_cast<void*>(static_cast<WGPUSampler>(sampler))); }
+
+    Stats stats() const { return m_stats; }
+
+private:
+    struct Group {
+        wgpu::BindGroup bindGroup = nullptr;
+        WGPUBindGroupLayout layout = nullptr;
+        std::vector<WGPUBindGroupEntry> entries; // Without their chained structs
+        std::string key;
+        uint64_t lastFrame = 0;
+        wgpu::SubmissionIndex lastSubmission = 0;
+    };
+
+    void invalidate(void* resource);
+    void evict(uint32_t group);
+
+    wgpu::Fence& m_fence;
+    wgpu::Device m_device;
+    uint32_t m_maxIdleFrames;
+    std::vector<Group> m_groups;
+    std::vector<uint32_t> m_unusedGroups;
+    std::unordered_multimap<uint64_t, uint32_t> m_byHash;
+    std::unordered_multimap<void*, uint32_t> m_byResource;
+    std::string m_scratch;
+    uint64_t m_frame = 1;
+    Stats m_stats;
+};
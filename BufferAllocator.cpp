@@ -0,0 +1,156 @@
+#include "BufferAllocator.h"
+#include "BindGroupCache.h"
+#include <algorithm>
+
+using namespace wgpu;
+
+BufferAllocator::BufferAllocator(Fence& fence, BufferUsageFlags usage, uint64_t pageSize, uint64_t alignment, const char* label)
+    : m_fence(fence), m_device(fence.getDevice()), m_usage(usage | BufferUsage::CopySrc | BufferUsage::CopyDst)
+    , m_pageSize((pageSize + alignment - 1) / alignment * alignment), m_label(label), m_tlsf(alignment) {}
+
+BufferAllocator::~BufferAllocator() {
+    m_fence.waitIdle();
+    for (Page& page : m_pages) {
+        if (!page.buffer) continue;
+        if (m_bindGroups) m_bindGroups->invalidate(page.buffer);
+        page.buffer.destroy();
+        page.buffer.release();
+    }
+}
+
+void BufferAllocator::addPage(uint64_t size) {
+    BufferDescriptor bufferDesc;
+    bufferDesc.label            = m_label;
+    bufferDesc.size             = size;
+    bufferDesc.usage            = m_usage; // Copy usages for uploads and defragmentation
+    bufferDesc.mappedAtCreation = false;
+    Page page;
+    page.buffer = m_device.createBuffer(bufferDesc);
+    m_tlsf.addRegion(size);
+    m_pages.push_back(page);
+    m_pageCount++;
+}
+
+BufferAllocation BufferAllocator::allocate(uint64_t size) {
+    if (size == 0) return BufferAllocation();
+    collect();
+    uint32_t block = m_tlsf.allocate(size);
+    if (block == Tlsf::kInvalid) {
+        addPage(std::max(m_pageSize, m_tlsf.regionSizeFor(size)));
+        block = m_tlsf.allocate(size);
+        if (block == Tlsf::kInvalid) return BufferAllocation();
+    }
+
+    uint32_t id;
+    if (!m_unusedIds.empty()) {
+        id = m_unusedIds.back();
+        m_unusedIds.pop_back();
+        m_blocks[id] = block;
+    } else {
+        id = (uint32_t)m_blocks.size();
+        m_blocks.push_back(block);
+    }
+    BufferAllocation allocation;
+    allocation.id = id;
+    update(allocation);
+    return allocation;
+}
+
+void BufferAllocator::free(const BufferAllocation& allocation) {
+    if (!allocation) return;
+    // Submissions in flight and the frame being recorded may still read the range
+    m_pending.push_back({ m_fence.lastSignaled() + 1, m_blocks[allocation.id] });
+    m_blocks[allocation.id] = Tlsf::kInvalid;
+    m_unusedIds.push_back(allocation.id);
+}
+
+void BufferAllocator::update(BufferAllocation& allocation) const {
+    uint32_t block = m_blocks[allocation.id];
+    allocation.buffer = m_pages[m_tlsf.region(block)].buffer;
+    allocation.offset = m_tlsf.offset(block);
+    allocation.size   = m_tlsf.size(block);
+}
+
+void BufferAllocator::collect() {
+    if (m_pending.empty()) return;
+    SubmissionIndex completed = m_fence.completedValue();
+    while (!m_pending.empty() && m_pending.front().value <= completed) {
+        uint32_t block = m_pending.front().block;
+        m_pending.pop_front();
+        uint32_t page = m_tlsf.region(block);
+        m_tlsf.free(block);
+        releasePageIfEmpty(page);
+    }
+}
+
+void BufferAllocator::releasePageIfEmpty(uint32_t page) {
+    // Regular pages are kept for reuse, dedicated ones would rarely fit another allocation
+    bool dedicated = m_tlsf.regionSize(page) > m_pageSize;
+    if (m_tlsf.regionAllocated(page) != 0 || (!m_pages[page].evacuated && !dedicated)) return;
+    m_tlsf.removeRegion(page);
+    if (m_bindGroups) m_bindGroups->invalidate(m_pages[page].buffer);
+    m_fence.destroyAfter(m_fence.lastSignaled() + 1, m_pages[page].buffer); // Copies out of it may be recorded
+    m_pages[page].buffer = nullptr;
+    m_pageCount--;
+}
+
+std::vector<BufferAllocator::Move> BufferAllocator::defragment(CommandEncoder encoder, double maxOccupancy) {
+    std::vector<Move> moves;
+    collect();
+
+    std::vector<uint32_t> candidates;
+    for (uint32_t page = 0; page < (uint32_t)m_pages.size(); page++) {
+        if (!m_pages[page].buffer || m_pages[page].evacuated) continue;
+        double occupancy = (double)m_tlsf.regionAllocated(page) / (double)m_tlsf.regionSize(page);
+        if (occupancy < maxOccupancy) candidates.push_back(page);
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+        return m_tlsf.regionAllocated(a) < m_tlsf.regionAllocated(b);
+    });
+
+    // Live allocations by page, ranges awaiting their free have no id and are not moved
+    std::vector<std::vector<uint32_t>> ids(m_pages.size());
+    for (uint32_t id = 0; id < (uint32_t)m_blocks.size(); id++) {
+        if (m_blocks[id] != Tlsf::kInvalid) ids[m_tlsf.region(m_blocks[id])].push_back(id);
+    }
+
+    std::vector<uint32_t> targets;
+    for (uint32_t page : candidates) {
+        // Allocate every destination first so that a page is either evacuated or left alone.
+        // WebGPU forbids copies within one buffer, which disabling the page rules out too.
+        m_tlsf.setRegionEnabled(page, false);
+        targets.clear();
+        for (uint32_t id : ids[page]) {
+            uint32_t target = m_tlsf.allocate(m_tlsf.size(m_blocks[id]));
+            if (target == Tlsf::kInvalid) break;
+            targets.push_back(target);
+        }
+        if (targets.size() < ids[page].size()) {
+            for (uint32_t target : targets) m_tlsf.free(target);
+            m_tlsf.setRegionEnabled(page, true);
+            continue; // A smaller page may still fit
+        }
+
+        m_pages[page].evacuated = true;
+        for (size_t i = 0; i < targets.size(); i++) {
+            uint32_t id = ids[page][i];
+            uint32_t block = m_blocks[id];
+            uint32_t targetPage = m_tlsf.region(targets[i]);
+            Move move{ id, m_pages[page].buffer, m_tlsf.offset(block), m_pages[targetPage].buffer, m_tlsf.offset(targets[i]) };
+            encoder.copyBufferToBuffer(move.oldBuffer, move.oldOffset, move.newBuffer, move.newOffset, m_tlsf.size(block));
+            moves.push_back(move);
+            ids[targetPage].push_back(id);
+            m_blocks[id] = targets[i];
+            m_tlsf.free(block); // Not reused, the page is disabled
+        }
+        releasePageIfEmpty(page);
+    }
+    return moves;
+}
+
+BufferAllocator::Stats BufferAllocator::stats() const {
+    Stats stats;
+    stats.pages  = m_pageCount;
+    stats.ranges = m_tlsf.stats();
+    return stats;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+#include "Tlsf.h"
+
+class BindGroupCache;
+
+// A range of one of a BufferAllocator's buffers. Allocations may move during defragment(),
+// refresh them with BufferAllocator::update() afterwards.
+struct BufferAllocation {
+    wgpu::Buffer buffer = nullptr;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t id = UINT32_MAX;
+
+    explicit operator bool() const { return id != UINT32_MAX; }
+};
+
+// Sub-allocates vertex, index or uniform data from a few large buffers of one usage class,
+// with a TLSF allocator per class (O(1) allocate and free). Offsets are multiples of the
+// alignment, 256 satisfies uniform and storage binding offsets.
+class BufferAllocator {
+public:
+    struct Stats {
+        uint32_t pages = 0;
+        Tlsf::Stats ranges;
+    };
+    struct Move {
+        uint32_t id;
+        wgpu::Buffer oldBuffer;
+        uint64_t oldOffset;
+        wgpu::Buffer newBuffer;
+        uint64_t newOffset;
+    };
+
+    BufferAllocator(wgpu::Fence& fence, wgpu::BufferUsageFlags usage, uint64_t pageSize = 64 << 20, uint64_t alignment = 256,
+                    const char* label = "Buffer allocator page");
+    ~BufferAllocator();
+    BufferAllocator(const BufferAllocator&) = delete;
+    BufferAllocator& operator=(const BufferAllocator&) = delete;
+
+    // Larger sizes than the page size get a page of their own
+    BufferAllocation allocate(uint64_t size);
+    // The range is reused once the submissions signaled so far have retired, so the GPU may
+    // still read it in the frame being recorded
+    void free(const BufferAllocation& allocation);
+    // Refreshes buffer and offset after a defragment() moved the allocation
+    void update(BufferAllocation& allocation) const;
+
+    // Empties the pages occupied below maxOccupancy, least occupied first, by copying their
+    // allocations into the other pages with the encoder, which must be submitted with the next
+    // Fence::signal. A page is only evacuated when all of it fits elsewhere, and the emptied
+    // pages are destroyed once that submission retires. Returns the moves, whose owners must
+    // update() their allocations and recreate their bind groups.
+    std::vector<Move> defragment(wgpu::CommandEncoder encoder, double maxOccupancy = 0.5);
+
+    // Groups of the cache that reference a page are dropped when the page is destroyed. The
+    // cache must outlive the allocator.
+    void setBindGroupCache(BindGroupCache* cache) { m_bindGroups = cache; }
+
+    Stats stats() const;
+
+private:
+    struct Page {
+        wgpu::Buffer buffer = nullptr;
+        bool evacuated = false; // Disabled, destroyed as soon as its pending frees are done
+    };
+    struct PendingFree {
+        wgpu::SubmissionIndex value; // Reusable once the fence completed it
+        uint32_t block;
+    };
+
+    void addPage(uint64_t size);
+    void releasePageIfEmpty(uint32_t page);
+    void collect();
+
+    wgpu::Fence& m_fence;
+    wgpu::Device m_device;
+    wgpu::BufferUsageFlags m_usage;
+    uint64_t m_pageSize;
+    const char* m_label;
+    Tlsf m_tlsf;
+    std::vector<Page> m_pages; // Indexed by Tlsf region, released pages keep a null entry
+    uint32_t m_pageCount = 0;
+    std::vector<uint32_t> m_blocks; // Allocation id to Tlsf block, kInvalid for unused ids
+    std::vector<uint32_t> m_unusedIds;
+    std::deque<PendingFree> m_pending;
+    BindGroupCache* m_bindGroups = nullptr;
+};
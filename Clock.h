@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <GLFW/glfw3.h>
+
+// Timer used for frame timing and profiling: glfwGetTimerValue while GLFW is initialized, the
+// steady clock otherwise. Headless runs never initialize GLFW since there may be no display.
+class Clock {
+public:
+    static void useGlfw(bool enabled) { s_glfw = enabled; } // Call once at startup
+
+    static uint64_t ticks() {
+        if (s_glfw) return glfwGetTimerValue();
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    }
+    static uint64_t frequency() {
+        return s_glfw ? glfwGetTimerFrequency() : 1000000000ull;
+    }
+    static double seconds() {
+        return (double)ticks() / (double)frequency();
+    }
+
+private:
+    static inline bool s_glfw = true;
+};
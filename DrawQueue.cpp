@@ -0,0 +1,185 @@
+#include "DrawQueue.h"
+#include "RenderPassRecorder.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace wgpu;
+
+namespace {
+constexpr uint32_t PipelineBits = 11;
+constexpr uint32_t BindGroupBits = 12;
+constexpr uint32_t MaterialBits = 12;
+constexpr uint32_t DepthBits = 24;
+
+uint64_t quantizeDepth(float depth) {
+    const uint32_t maxDepth = (1u << DepthBits) - 1;
+    if (!(depth > 0.0f)) return 0; // Also NaN
+    if (depth >= 1.0f) return maxDepth;
+    return (uint64_t)(depth * (float)maxDepth);
+}
+
+uint64_t field(uint32_t value, uint32_t bits) {
+    return value & ((1u << bits) - 1);
+}
+} // namespace
+
+void DrawQueue::radixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch) {
+    constexpr uint32_t Digits = 8;
+    size_t count = entries.size();
+    scratch.resize(count);
+    if (count < 2) return;
+
+    // All the histograms in one read of the keys
+    uint32_t histograms[Digits][256] = {};
+    for (const Entry& entry : entries) {
+        for (uint32_t d = 0; d < Digits; d++) histograms[d][(entry.key >> (8 * d)) & 0xff]++;
+    }
+
+    Entry* source = entries.data();
+    Entry* destination = scratch.data();
+    for (uint32_t d = 0; d < Digits; d++) {
+        uint32_t* histogram = histograms[d];
+        if (histogram[(source[0].key >> (8 * d)) & 0xff] == count) continue; // Every key has this digit
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t n = histogram[i];
+            histogram[i] = offset;
+            offset += n;
+        }
+        const uint32_t shift = 8 * d;
+        for (size_t i = 0; i < count; i++) {
+            Entry entry = source[i];
+            destination[histogram[(entry.key >> shift) & 0xff]++] = entry;
+        }
+        std::swap(source, destination);
+    }
+    if (source != entries.data()) entries.swap(scratch);
+}
+
+template <typename Handle>
+uint32_t DrawQueue::Ids<Handle>::get(Handle handle, uint32_t bits) {
+    if (handle == last) return lastId;
+    auto it = ids.find(handle);
+    if (it == ids.end()) it = ids.emplace(handle, (uint32_t)ids.size()).first;
+    last = handle;
+    lastId = (uint32_t)field(it->second, bits);
+    return lastId;
+}
+
+uint64_t DrawQueue::opaqueKey(uint32_t pass, uint32_t pipeline, uint32_t bindGroup, uint32_t material, float depth) {
+    return field(pass, 4) << 60
+        | field(pipeline, PipelineBits) << (BindGroupBits + MaterialBits + DepthBits)
+        | field(bindGroup, BindGroupBits) << (MaterialBits + DepthBits)
+        | field(material, MaterialBits) << DepthBits
+        | quantizeDepth(depth);
+}
+
+uint64_t DrawQueue::transparentKey(uint32_t pass, uint32_t pipeline, uint32_t bindGroup, uint32_t material, float depth) {
+    const uint64_t farthestFirst = ((1u << DepthBits) - 1) - quantizeDepth(depth);
+    return field(pass, 4) << 60
+        | 1ull << 59
+        | farthestFirst << (PipelineBits + BindGroupBits + MaterialBits)
+        | field(pipeline, PipelineBits) << (BindGroupBits + MaterialBits)
+        | field(bindGroup, BindGroupBits) << MaterialBits
+        | field(material, MaterialBits);
+}
+
+void DrawQueue::begin() {
+    m_draws.clear();
+    m_entries.clear();
+    m_sorted = false;
+    // Ids are kept across frames so that keys stay stable, until they start wrapping
+    if (m_pipelineIds.ids.size() > (1u << PipelineBits) || m_bindGroupIds.ids.size() > (1u << BindGroupBits)) {
+        m_pipelineIds = Ids<WGPURenderPipeline>();
+        m_bindGroupIds = Ids<WGPUBindGroup>();
+    }
+}
+
+void DrawQueue::submit(uint32_t pass, const Draw& draw, uint32_t material, float depth, bool transparent) {
+    assert(pass < MaxPasses);
+    if (pass >= MaxPasses) return; // Would wrap into another pass's 4 key bits
+    uint32_t pipeline = m_pipelineIds.get(draw.pipeline, PipelineBits);
+    uint32_t bindGroup = draw.bindGroup ? m_bindGroupIds.get(draw.bindGroup, BindGroupBits) : 0;
+    uint64_t key = transparent ? transparentKey(pass, pipeline, bindGroup, material, depth)
+                               : opaqueKey(pass, pipeline, bindGroup, material, depth);
+    m_entries.push_back({ key, (uint32_t)m_draws.size() });
+    m_draws.push_back(draw);
+    m_sorted = false;
+}
+
+void DrawQueue::sort() {
+    radixSort(m_entries, m_scratch);
+    m_sorted = true;
+}
+
+std::pair<const DrawQueue::Entry*, const DrawQueue::Entry*> DrawQueue::passEntries(uint32_t pass) const {
+    const Entry* begin = m_entries.data();
+    const Entry* end = begin + m_entries.size();
+    if (m_sorted) {
+        // The pass is the top of the key, its draws are contiguous
+        begin = std::partition_point(begin, end, [pass](const Entry& entry) { return passOf(entry.key) < pass; });
+        end = std::partition_point(begin, end, [pass](const Entry& entry) { return passOf(entry.key) == pass; });
+    }
+    return { begin, end };
+}
+
+void DrawQueue::collect(uint32_t pass, std::vector<const Draw*>& draws) const {
+    auto [begin, end] = passEntries(pass);
+    for (const Entry* entry = begin; entry != end; entry++) {
+        if (passOf(entry->key) == pass) draws.push_back(&m_draws[entry->draw]);
+    }
+}
+
+void DrawQueue::replay(RenderPassRecorder& renderPass, uint32_t pass) const {
+    auto [begin, end] = passEntries(pass);
+    for (const Entry* it = begin; it != end; ++it) {
+        const Entry& entry = *it;
+        if (passOf(entry.key) != pass) continue;
+        const Draw& draw = m_draws[entry.draw];
+        renderPass.setPipeline(draw.pipeline);
+        if (draw.bindGroup) renderPass.setBindGroup(0, draw.bindGroup);
+        if (draw.objectGroup) renderPass.setBindGroup(1, draw.objectGroup, 1, &draw.objectOffset);
+        if (draw.vertexBuffer) renderPass.setVertexBuffer(0, draw.vertexBuffer);
+        if (draw.indexBuffer) {
+            renderPass.setIndexBuffer(draw.indexBuffer, draw.indexFormat);
+            renderPass.drawIndexed(draw.count, draw.instanceCount, draw.first, draw.baseVertex, draw.firstInstance);
+        } else {
+            renderPass.draw(draw.count, draw.instanceCount, draw.first, draw.firstInstance);
+        }
+    }
+}
+
+void encodeDraws(RenderBundleEncoder encoder, const DrawQueue::Draw* const* draws, uint32_t count) {
+    // Bundles start without state
+    WGPURenderPipeline pipeline = nullptr;
+    WGPUBindGroup bindGroup = nullptr;
+    WGPUBuffer vertexBuffer = nullptr;
+    WGPUBuffer indexBuffer = nullptr;
+    WGPUIndexFormat indexFormat = WGPUIndexFormat_Undefined;
+    for (uint32_t i = 0; i < count; i++) {
+        const DrawQueue::Draw& draw = *draws[i];
+        if (draw.pipeline != pipeline) {
+            pipeline = draw.pipeline;
+            encoder.setPipeline(draw.pipeline);
+        }
+        if (draw.bindGroup && draw.bindGroup != bindGroup) {
+            bindGroup = draw.bindGroup;
+            encoder.setBindGroup(0, draw.bindGroup, 0, nullptr);
+        }
+        if (draw.objectGroup) encoder.setBindGroup(1, draw.objectGroup, 1, &draw.objectOffset);
+        if (draw.vertexBuffer && draw.vertexBuffer != vertexBuffer) {
+            vertexBuffer = draw.vertexBuffer;
+            encoder.setVertexBuffer(0, draw.vertexBuffer, 0, WGPU_WHOLE_SIZE);
+        }
+        if (draw.indexBuffer) {
+            if (draw.indexBuffer != indexBuffer || draw.indexFormat != indexFormat) {
+                indexBuffer = draw.indexBuffer;
+                indexFormat = draw.indexFormat;
+                encoder.setIndexBuffer(draw.indexBuffer, draw.indexFormat, 0, WGPU_WHOLE_SIZE);
+            }
+            encoder.drawIndexed(draw.count, draw.instanceCount, draw.first, draw.baseVertex, draw.firstInstance);
+        } else {
+            encoder.draw(draw.count, draw.instanceCount, draw.first, draw.firstInstance);
+        }
+    }
+}
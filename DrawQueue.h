@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+class RenderPassRecorder;
+
+// Collects a frame's draws with 64 bit sort keys and replays them in key order.
+//
+// Keys are, from the most significant bit:
+//   opaque       pass:4 | 0 | pipeline:11 | bind group:12 | material:12 | depth:24
+//   transparent  pass:4 | 1 | ~depth:24   | pipeline:11  | bind group:12 | material:12
+// so each pass draws its opaque draws grouped by state then front to back, followed by its
+// transparent draws back to front. Pipelines and bind groups get small ids in order of first
+// use; once the ids run out they wrap, which only costs some grouping, never correctness.
+// Keys are sorted with an LSD radix sort (8 bit digits, digits shared by every key skipped)
+// and replayed through a RenderPassRecorder, which drops the state changes the order made
+// redundant.
+class DrawQueue {
+public:
+    struct Draw {
+        wgpu::RenderPipeline pipeline = nullptr;
+        wgpu::BindGroup bindGroup = nullptr;   // Group 0, part of the key
+        wgpu::BindGroup objectGroup = nullptr; // Group 1 if set, with one dynamic offset
+        uint32_t objectOffset = 0;
+        wgpu::Buffer vertexBuffer = nullptr;   // Slot 0
+        wgpu::Buffer indexBuffer = nullptr;
+        WGPUIndexFormat indexFormat = WGPUIndexFormat_Uint32;
+        uint32_t count = 0;                    // Indices, or vertices without index buffer
+        uint32_t instanceCount = 1;
+        uint32_t first = 0;
+        int32_t baseVertex = 0;
+        uint32_t firstInstance = 0;
+    };
+
+    static constexpr uint32_t MaxPasses = 16;
+
+    // Clears the previous frame's draws
+    void begin();
+    // pass < MaxPasses, draws of other passes are dropped. depth is the view depth normalized to
+    // [0, 1], material any 12 bit id to group draws by
+    void submit(uint32_t pass, const Draw& draw, uint32_t material, float depth, bool transparent = false);
+    void sort();
+    // Replays the draws of one pass, in key order after sort() and submission order before
+    void replay(RenderPassRecorder& renderPass, uint32_t pass) const;
+    // Appends the draws of one pass in replay order, e.g. to record them on several threads
+    void collect(uint32_t pass, std::vector<const Draw*>& draws) const;
+
+    uint32_t drawCount() const { return (uint32_t)m_draws.size(); }
+
+    static uint64_t opaqueKey(uint32_t pass, uint32_t pipeline, uint32_t bindGroup, uint32_t material, float depth);
+    static uint64_t transparentKey(uint32_t pass, uint32_t pipeline, uint32_t bindGroup, uint32_t material, float depth);
+    static uint32_t passOf(uint64_t key) { return (uint32_t)(key >> 60); }
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t draw;
+    };
+
+    template <typename Handle>
+    struct Ids {
+        std::unordered_map<Handle, uint32_t> ids;
+        Handle last = nullptr; // Draws often come in runs with the same state
+        uint32_t lastId = 0;
+        uint32_t get(Handle handle, uint32_t bits);
+    };
+
+    // The pass's entries, a range of the sorted entries or all of them before sort()
+    std::pair<const Entry*, const Entry*> passEntries(uint32_t pass) const;
+    // Stable, scratch is the other buffer
+    static void radixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch);
+
+    std::vector<Draw> m_draws;
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_scratch;
+    Ids<WGPURenderPipeline> m_pipelineIds;
+    Ids<WGPUBindGroup> m_bindGroupIds;
+    bool m_sorted = false;
+};
+
+// Records draws into a bundle encoder, skipping the state that repeats the previous draw's
+void encodeDraws(wgpu::RenderBundleEncoder encoder, const DrawQueue::Draw* const* draws, uint32_t count);
@@ -0,0 +1,183 @@
+#include "FrameCapture.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stb_image_write.h>
+
+using namespace wgpu;
+
+FrameCapture::FrameCapture(Device device, uint32_t readbackBuffers, uint32_t workerCount) : m_device(device) {
+    if (workerCount == 0) workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1; // hardware_concurrency() may be 0
+    for (uint32_t i = 0; i < readbackBuffers; i++) m_readbacks.push_back(std::make_unique<Readback>());
+    m_maxQueued = 2 * workerCount + 2; // Bounds the memory held by images waiting for a worker
+    for (uint32_t i = 0; i < workerCount; i++) m_workers.emplace_back([this]() { workerMain(); });
+}
+
+FrameCapture::~FrameCapture() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+    for (auto& readback : m_readbacks) {
+        if (!readback->buffer) continue;
+        readback->buffer.destroy();
+        readback->buffer.release();
+    }
+}
+
+bool FrameCapture::capture(CommandEncoder encoder, Texture texture, TextureFormat format, uint32_t width, uint32_t height, std::string path) {
+    bool bgra = format == TextureFormat::BGRA8Unorm || format == TextureFormat::BGRA8UnormSrgb;
+    if (!bgra && format != TextureFormat::RGBA8Unorm && format != TextureFormat::RGBA8UnormSrgb) {
+        std::cerr << "Frame capture only supports 8 bit RGBA/BGRA targets" << std::endl;
+        m_failed++;
+        return false;
+    }
+    auto it = std::find_if(m_readbacks.begin(), m_readbacks.end(), [](const auto& r) { return r->state == Readback::State::Free; });
+    if (it == m_readbacks.end()) {
+        m_skipped++; // Every readback is still in flight, never wait for one
+        return false;
+    }
+    Readback& readback = **it;
+
+    uint32_t bytesPerRow = (width * 4 + 255) & ~255u; // copyTextureToBuffer rows are 256 byte aligned
+    uint64_t size = (uint64_t)bytesPerRow * height;
+    if (readback.size < size) {
+        if (readback.buffer) {
+            readback.buffer.destroy();
+            readback.buffer.release();
+        }
+        BufferDescriptor bufferDesc;
+        bufferDesc.label            = "Capture readback";
+        bufferDesc.size             = size;
+        bufferDesc.usage            = BufferUsage::MapRead | BufferUsage::CopyDst;
+        bufferDesc.mappedAtCreation = false;
+        readback.buffer = m_device.createBuffer(bufferDesc);
+        readback.size   = size;
+    }
+
+    ImageCopyTexture source;
+    source.texture  = texture;
+    source.mipLevel = 0;
+    source.origin   = { 0, 0, 0 };
+    source.aspect   = TextureAspect::All;
+    ImageCopyBuffer destination;
+    destination.buffer              = readback.buffer;
+    destination.layout.offset       = 0;
+    destination.layout.bytesPerRow  = bytesPerRow;
+    destination.layout.rowsPerImage = height;
+    encoder.copyTextureToBuffer(source, destination, { width, height, 1 });
+
+    readback.state       = Readback::State::Recorded;
+    readback.width       = width;
+    readback.height      = height;
+    readback.bytesPerRow = bytesPerRow;
+    readback.bgra        = bgra;
+    readback.path        = std::move(path);
+    return true;
+}
+
+void FrameCapture::endFrame() {
+    for (auto& r : m_readbacks) {
+        if (r->state != Readback::State::Recorded) continue;
+        Readback* readback = r.get();
+        readback->state = Readback::State::Mapping;
+        size_t size = (size_t)readback->bytesPerRow * readback->height;
+        readback->buffer.mapAsync(MapMode::Read, 0, size, [this, readback](BufferMapAsyncStatus status) {
+            if (status == BufferMapAsyncStatus::Success) {
+                readback->state = Readback::State::Mapped;
+            } else {
+                readback->state = Readback::State::Free;
+                m_failed++;
+            }
+        });
+    }
+}
+
+void FrameCapture::update() {
+    bool mapping = false;
+    for (auto& readback : m_readbacks) mapping |= readback->state == Readback::State::Mapping;
+    if (mapping) m_device.poll(false, nullptr);
+
+    for (auto& readback : m_readbacks) {
+        if (readback->state != Readback::State::Mapped) continue;
+        {
+            // Workers behind: keep the buffer mapped, which eventually skips new captures
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.size() >= m_maxQueued) break;
+        }
+        retrieve(*readback);
+    }
+}
+
+void FrameCapture::flush() {
+    for (auto& readback : m_readbacks) {
+        while (readback->state == Readback::State::Mapping) m_device.poll(true, nullptr);
+        if (readback->state == Readback::State::Mapped) retrieve(*readback);
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this]() { return m_queue.empty() && m_encoding == 0; });
+}
+
+void FrameCapture::retrieve(Readback& readback) {
+    Image image;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freePixels.empty()) {
+            image.pixels = std::move(m_freePixels.back());
+            m_freePixels.pop_back();
+        }
+    }
+    size_t rowSize = (size_t)readback.width * 4;
+    image.pixels.resize(rowSize * readback.height);
+    image.width  = readback.width;
+    image.height = readback.height;
+    image.bgra   = readback.bgra;
+    image.path   = std::move(readback.path);
+
+    size_t size = (size_t)readback.bytesPerRow * readback.height;
+    const uint8_t* data = static_cast<const uint8_t*>(readback.buffer.getConstMappedRange(0, size));
+    if (data) {
+        for (uint32_t y = 0; y < readback.height; y++) {
+            memcpy(image.pixels.data() + y * rowSize, data + (size_t)y * readback.bytesPerRow, rowSize);
+        }
+    }
+    readback.buffer.unmap();
+    readback.state = Readback::State::Free;
+    if (!data) {
+        m_failed++;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(image));
+    }
+    m_workAvailable.notify_one();
+}
+
+void FrameCapture::workerMain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_workAvailable.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+        if (m_queue.empty()) return; // Quitting
+        Image image = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_encoding++;
+        lock.unlock();
+
+        if (image.bgra) {
+            for (size_t i = 0; i < image.pixels.size(); i += 4) std::swap(image.pixels[i], image.pixels[i + 2]);
+        }
+        int stride = (int)image.width * 4;
+        bool ok = stbi_write_png(image.path.c_str(), (int)image.width, (int)image.height, 4, image.pixels.data(), stride) != 0;
+        if (ok) m_written++; else m_failed++;
+
+        lock.lock();
+        m_encoding--;
+        m_freePixels.push_back(std::move(image.pixels));
+        m_workDone.notify_all();
+    }
+}
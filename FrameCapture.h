@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+// Captures render targets to PNG files without stalling the render loop.
+//
+// capture() records a copyTextureToBuffer into a free buffer of a small readback ring and
+// endFrame() starts mapping it once the frame was submitted. update() picks up the buffers
+// whose mapping completed, copies their rows into a pooled pixel buffer, unmaps them and
+// queues the image for a pool of worker threads that encode and write it with stb_image_write.
+// The render thread only ever pays for recording the copy and one memcpy per captured frame.
+// When all readback buffers are in flight or the workers are too far behind, the frame is
+// skipped rather than waited for, see skippedCount().
+class FrameCapture {
+public:
+    // workerCount 0 uses one worker per hardware thread, minus the render thread
+    FrameCapture(wgpu::Device device, uint32_t readbackBuffers = 4, uint32_t workerCount = 0);
+    ~FrameCapture();
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Records a copy of the texture's first mip into a readback buffer. The texture must have
+    // CopySrc usage and an 8 bit RGBA or BGRA format. Returns false when the frame is skipped.
+    bool capture(wgpu::CommandEncoder encoder, wgpu::Texture texture, wgpu::TextureFormat format,
+                 uint32_t width, uint32_t height, std::string path);
+    // Call after the frame's commands were submitted, starts mapping this frame's captures
+    void endFrame();
+    // Non-blocking, hands completed readbacks over to the workers. Call once per frame.
+    void update();
+    // Blocks until every capture so far is written to disk
+    void flush();
+
+    uint64_t writtenCount() const { return m_written; }
+    uint64_t skippedCount() const { return m_skipped; }
+    uint64_t failedCount() const { return m_failed; }
+
+private:
+    struct Readback {
+        enum class State { Free, Recorded, Mapping, Mapped };
+        State state = State::Free;
+        wgpu::Buffer buffer = nullptr;
+        uint64_t size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t bytesPerRow = 0;
+        bool bgra = false;
+        std::string path;
+    };
+    struct Image {
+        std::vector<uint8_t> pixels; // Tightly packed RGBA8
+        uint32_t width = 0;
+        uint32_t height = 0;
+        bool bgra = false;
+        std::string path;
+    };
+
+    void retrieve(Readback& readback);
+    void workerMain();
+
+    wgpu::Device m_device;
+    std::vector<std::unique_ptr<Readback>> m_readbacks;
+
+    // Shared with the workers
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    std::deque<Image> m_queue;
+    std::vector<std::vector<uint8_t>> m_freePixels; // Recycled pixel storage
+    size_t m_maxQueued;
+    size_t m_encoding = 0;
+    bool m_quit = false;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<uint64_t> m_written{ 0 };
+    std::atomic<uint64_t> m_failed{ 0 };
+    uint64_t m_skipped = 0;
+};
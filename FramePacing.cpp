@@ -0,0 +1,91 @@
+#include "FramePacing.h"
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "Clock.h"
+
+using namespace wgpu;
+
+PresentMode choosePresentMode(Surface surface, Adapter adapter, PacingPolicy policy) {
+    SurfaceCapabilities caps;
+    surface.getCapabilities(adapter, &caps); // First call only fills in the counts
+    std::vector<WGPUPresentMode> modes(caps.presentModeCount);
+    caps.formatCount = 0;
+    caps.alphaModeCount = 0;
+    caps.presentModes = modes.data();
+    surface.getCapabilities(adapter, &caps);
+
+    auto supported = [&modes](WGPUPresentMode mode) {
+        return std::find(modes.begin(), modes.end(), mode) != modes.end();
+    };
+    switch (policy) {
+    case PacingPolicy::LowestLatency:
+    case PacingPolicy::TargetFps:
+        if (supported(PresentMode::Mailbox)) return PresentMode::Mailbox; // No tearing, never blocks
+        if (supported(PresentMode::Immediate)) return PresentMode::Immediate;
+        break;
+    case PacingPolicy::LowestPower:
+        break;
+    }
+    return PresentMode::Fifo; // Always supported
+}
+
+FrameLimiter::FrameLimiter(double targetFps) {
+    setTargetFps(targetFps);
+}
+
+void FrameLimiter::setTargetFps(double targetFps) {
+    double frequency = (double)Clock::frequency();
+    m_period = targetFps > 0.0 ? (uint64_t)(frequency / targetFps) : 0;
+    m_spinThreshold = (uint64_t)(frequency * 0.002); // Sleep granularity can be ~1ms on Windows
+    m_next = 0;
+}
+
+void FrameLimiter::wait() {
+    if (m_period == 0) return;
+    uint64_t now = Clock::ticks();
+    if (m_next == 0 || now > m_next + m_period) {
+        m_next = now + m_period; // First frame, or we fell behind: resync instead of bursting
+        return;
+    }
+    double frequency = (double)Clock::frequency();
+    while (now + m_spinThreshold < m_next) {
+        auto sleep = std::chrono::duration<double>((double)(m_next - now - m_spinThreshold) / frequency);
+        std::this_thread::sleep_for(sleep);
+        now = Clock::ticks();
+    }
+    while (now < m_next) now = Clock::ticks();
+    m_next += m_period;
+}
+
+void FrameTimeStats::addSample(double seconds) {
+    m_count++;
+    double delta = seconds - m_mean;
+    m_mean += delta / (double)m_count;
+    m_m2 += delta * (seconds - m_mean);
+    m_min = m_count == 1 ? seconds : std::min(m_min, seconds);
+    m_max = m_count == 1 ? seconds : std::max(m_max, seconds);
+}
+
+void FrameTimeStats::reset() {
+    *this = FrameTimeStats();
+}
+
+const char* toString(PacingPolicy policy) {
+    switch (policy) {
+    case PacingPolicy::LowestLatency: return "lowest latency";
+    case PacingPolicy::LowestPower:   return "lowest power";
+    case PacingPolicy::TargetFps:     return "target fps";
+    }
+    return "?";
+}
+
+const char* toString(PresentMode mode) {
+    switch (mode) {
+    case PresentMode::Immediate: return "Immediate";
+    case PresentMode::Mailbox:   return "Mailbox";
+    case PresentMode::Fifo:      return "Fifo";
+    default:                     return "?";
+    }
+}
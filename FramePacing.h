@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+enum class PacingPolicy {
+    LowestLatency, // Mailbox, else Immediate. Never waits on vblank.
+    LowestPower,   // Fifo, the GPU idles until vblank.
+    TargetFps,     // Non-blocking present mode plus a CPU frame limiter.
+};
+
+struct FramePacingConfig {
+    PacingPolicy policy = PacingPolicy::LowestPower;
+    double targetFps = 60.0; // Only used by PacingPolicy::TargetFps
+};
+
+// Picks the best present mode the surface actually supports for the given policy.
+wgpu::PresentMode choosePresentMode(wgpu::Surface surface, wgpu::Adapter adapter, PacingPolicy policy);
+
+// Hybrid sleep/spin limiter: sleeps while the next deadline is far away and spins on
+// the clock (glfwGetTimerValue) for the last stretch, where OS sleeps are too coarse to hit it.
+class FrameLimiter {
+public:
+    explicit FrameLimiter(double targetFps = 0.0); // 0 disables limiting
+    void setTargetFps(double targetFps);
+    void wait(); // Call once per frame
+private:
+    uint64_t m_period = 0; // In timer ticks
+    uint64_t m_spinThreshold = 0;
+    uint64_t m_next = 0;
+};
+
+// Running mean/variance of frame times (Welford), in seconds.
+class FrameTimeStats {
+public:
+    void addSample(double seconds);
+    void reset();
+    uint64_t count() const { return m_count; }
+    double mean() const { return m_mean; }
+    double variance() const { return m_count > 1 ? m_m2 / (double)(m_count - 1) : 0.0; }
+    double min() const { return m_min; }
+    double max() const { return m_max; }
+private:
+    uint64_t m_count = 0;
+    double m_mean = 0.0;
+    double m_m2 = 0.0;
+    double m_min = 0.0;
+    double m_max = 0.0;
+};
+
+const char* toString(PacingPolicy policy);
+const char* toString(wgpu::PresentMode mode);
@@ -0,0 +1,259 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include "Clock.h"
+
+using namespace wgpu;
+
+struct FrameProfiler::ReadbackSlot {
+    enum class State { Free, Recording, Mapping, Mapped };
+    State state = State::Free;
+    uint32_t firstQuery = 0;
+    Buffer resolve = nullptr;
+    Buffer readback = nullptr;
+    std::vector<PassScope> passes;
+    double cpuStart = 0.0; // Microseconds, where the frame's GPU scopes are placed in traces
+};
+
+FrameProfiler::FrameProfiler(Device device, uint32_t maxPassesPerFrame, uint32_t readbackFrames, size_t historySize)
+    : m_device(device), m_maxPasses(maxPassesPerFrame), m_historySize(historySize) {
+    m_timerFrequency = (double)Clock::frequency();
+    m_origin = Clock::ticks();
+
+    if (m_device.hasFeature(FeatureName::TimestampQuery)) {
+        QuerySetDescriptor querySetDesc;
+        querySetDesc.label = "Profiler timestamps";
+        querySetDesc.type  = QueryType::Timestamp;
+        querySetDesc.count = 2 * m_maxPasses * readbackFrames;
+        m_querySet = m_device.createQuerySet(querySetDesc);
+    }
+
+    uint64_t size = 2 * m_maxPasses * sizeof(uint64_t);
+    for (uint32_t i = 0; i < readbackFrames; i++) {
+        auto slot = std::make_unique<ReadbackSlot>();
+        slot->firstQuery = 2 * m_maxPasses * i;
+        if (m_querySet) {
+            BufferDescriptor bufferDesc;
+            bufferDesc.label = "Profiler resolve";
+            bufferDesc.size  = size;
+            bufferDesc.usage = BufferUsage::QueryResolve | BufferUsage::CopySrc;
+            slot->resolve = m_device.createBuffer(bufferDesc);
+            bufferDesc.label = "Profiler readback";
+            bufferDesc.usage = BufferUsage::MapRead | BufferUsage::CopyDst;
+            slot->readback = m_device.createBuffer(bufferDesc);
+        }
+        slot->passes.reserve(m_maxPasses);
+        m_slots.push_back(std::move(slot));
+    }
+    m_cpuScopes.reserve(64);
+}
+
+FrameProfiler::~FrameProfiler() {
+    bool mapping = false;
+    for (auto& slot : m_slots) mapping |= slot->state == ReadbackSlot::State::Mapping;
+    if (mapping) m_device.poll(true, nullptr); // Map callbacks reference the slots
+    for (auto& slot : m_slots) {
+        if (!slot->resolve) continue;
+        slot->resolve.destroy();
+        slot->resolve.release();
+        slot->readback.destroy();
+        slot->readback.release();
+    }
+    if (m_querySet) {
+        m_querySet.destroy();
+        m_querySet.release();
+    }
+}
+
+void FrameProfiler::beginFrame() {
+    m_frameStart = Clock::ticks();
+    m_frame++;
+    m_current = nullptr;
+    for (auto& slot : m_slots) {
+        if (slot->state == ReadbackSlot::State::Mapped) readBack(*slot);
+        if (!m_current && slot->state == ReadbackSlot::State::Free && m_querySet) m_current = slot.get();
+    }
+    if (m_current) {
+        m_current->state = ReadbackSlot::State::Recording;
+        m_current->passes.clear();
+        m_current->cpuStart = cpuMicroseconds(m_frameStart);
+    }
+}
+
+uint32_t FrameProfiler::beginPass(CommandEncoder encoder, const char* name) {
+    if (!m_current || m_current->passes.size() == m_maxPasses) return UINT32_MAX;
+    uint32_t scope = (uint32_t)m_current->passes.size();
+    m_current->passes.push_back({ name, m_current->firstQuery + 2 * scope });
+    encoder.writeTimestamp(m_querySet, m_current->passes.back().firstQuery);
+    return scope;
+}
+
+void FrameProfiler::endPass(CommandEncoder encoder, uint32_t scope) {
+    if (!m_current || scope == UINT32_MAX) return;
+    encoder.writeTimestamp(m_querySet, m_current->passes[scope].firstQuery + 1);
+}
+
+void FrameProfiler::resolve(CommandEncoder encoder) {
+    if (!m_current || m_current->passes.empty()) return;
+    uint32_t queryCount = 2 * (uint32_t)m_current->passes.size();
+    encoder.resolveQuerySet(m_querySet, m_current->firstQuery, queryCount, m_current->resolve, 0);
+    encoder.copyBufferToBuffer(m_current->resolve, 0, m_current->readback, 0, queryCount * sizeof(uint64_t));
+}
+
+void FrameProfiler::endFrame() {
+    ReadbackSlot* slot = m_current;
+    m_current = nullptr;
+    if (!slot) return;
+    if (slot->passes.empty()) {
+        slot->state = ReadbackSlot::State::Free;
+        return;
+    }
+    slot->state = ReadbackSlot::State::Mapping;
+    size_t size = 2 * slot->passes.size() * sizeof(uint64_t);
+    slot->readback.mapAsync(MapMode::Read, 0, size, [slot](BufferMapAsyncStatus status) {
+        slot->state = status == BufferMapAsyncStatus::Success ? ReadbackSlot::State::Mapped : ReadbackSlot::State::Free;
+    });
+}
+
+void FrameProfiler::flush() {
+    for (auto& slot : m_slots) {
+        while (slot->state == ReadbackSlot::State::Mapping) m_device.poll(true, nullptr);
+        if (slot->state == ReadbackSlot::State::Mapped) readBack(*slot);
+    }
+}
+
+void FrameProfiler::reset() {
+    flush(); // Frames submitted before the reset must not leak into the new samples
+    m_histories.clear();
+    m_trace.clear();
+    m_traceNext = 0;
+}
+
+void FrameProfiler::readBack(ReadbackSlot& slot) {
+    size_t size = 2 * slot.passes.size() * sizeof(uint64_t);
+    const uint64_t* timestamps = static_cast<const uint64_t*>(slot.readback.getConstMappedRange(0, size));
+    if (timestamps) {
+        uint64_t origin = UINT64_MAX;
+        for (size_t i = 0; i < 2 * slot.passes.size(); i++) origin = std::min(origin, timestamps[i]);
+        for (size_t i = 0; i < slot.passes.size(); i++) {
+            uint64_t begin = timestamps[2 * i];
+            uint64_t end = timestamps[2 * i + 1];
+            if (end < begin) continue; // Invalid, e.g. the timestamp counter was reset
+            double start = slot.cpuStart + 1e-3 * timestampPeriod * (double)(begin - origin);
+            addSample(slot.passes[i].name, true, start, 1e-3 * timestampPeriod * (double)(end - begin));
+        }
+    }
+    slot.readback.unmap();
+    slot.state = ReadbackSlot::State::Free;
+}
+
+uint32_t FrameProfiler::beginCpu(const char* name) {
+    m_cpuScopes.push_back({ name, Clock::ticks() });
+    return (uint32_t)m_cpuScopes.size() - 1;
+}
+
+void FrameProfiler::endCpu(uint32_t scope) {
+    if (scope >= m_cpuScopes.size()) return;
+    uint64_t end = Clock::ticks();
+    const CpuScope& cpuScope = m_cpuScopes[scope];
+    double start = cpuMicroseconds(cpuScope.start);
+    addSample(cpuScope.name, false, start, cpuMicroseconds(end) - start);
+    m_cpuScopes.resize(scope); // Scopes nest, so this one is on top of the stack
+}
+
+double FrameProfiler::cpuMicroseconds(uint64_t ticks) const {
+    return 1e6 * (double)(ticks - m_origin) / m_timerFrequency;
+}
+
+void FrameProfiler::addSample(const char* name, bool gpu, double start, double duration) {
+    History& h = history(name, gpu);
+    h.samples[h.next] = 1e-3 * duration;
+    h.next = (h.next + 1) % h.samples.size();
+    h.count = std::min(h.count + 1, h.samples.size());
+
+    if (m_trace.size() < m_traceCapacity) {
+        m_trace.push_back({ name, gpu, start, duration });
+    } else {
+        m_trace[m_traceNext] = { name, gpu, start, duration };
+        m_traceNext = (m_traceNext + 1) % m_traceCapacity;
+    }
+}
+
+FrameProfiler::History& FrameProfiler::history(const char* name, bool gpu) {
+    for (History& h : m_histories) {
+        if (h.gpu == gpu && (h.name == name || strcmp(h.name, name) == 0)) return h;
+    }
+    History h;
+    h.name = name;
+    h.gpu  = gpu;
+    h.samples.resize(m_historySize);
+    m_histories.push_back(std::move(h));
+    return m_histories.back();
+}
+
+const FrameProfiler::History* FrameProfiler::findHistory(const char* name, bool gpu) const {
+    for (const History& h : m_histories) {
+        if (h.gpu == gpu && strcmp(h.name, name) == 0) return &h;
+    }
+    return nullptr;
+}
+
+static FrameProfiler::Stats computeStats(const std::vector<double>& samples, size_t count) {
+    FrameProfiler::Stats stats;
+    if (count == 0) return stats;
+    std::vector<double> sorted(samples.begin(), samples.begin() + count);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) { return sorted[std::min(sorted.size() - 1, (size_t)(p * (double)sorted.size()))]; };
+    stats.samples = count;
+    stats.min = sorted.front();
+    for (double sample : sorted) stats.mean += sample;
+    stats.mean /= (double)count;
+    stats.p50 = percentile(0.50);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    return stats;
+}
+
+FrameProfiler::Stats FrameProfiler::gpuStats(const char* name) const {
+    const History* h = findHistory(name, true);
+    return h ? computeStats(h->samples, h->count) : Stats();
+}
+
+FrameProfiler::Stats FrameProfiler::cpuStats(const char* name) const {
+    const History* h = findHistory(name, false);
+    return h ? computeStats(h->samples, h->count) : Stats();
+}
+
+void FrameProfiler::printSummary(std::ostream& out) const {
+    out << "Frame profile over the last " << m_historySize << " samples (p50 / p95 / p99 ms)" << std::endl;
+    if (!gpuTimingSupported()) out << "  (no GPU timings, TimestampQuery is not supported by this device)" << std::endl;
+    for (const History& h : m_histories) {
+        Stats stats = computeStats(h.samples, h.count);
+        out << "  " << (h.gpu ? "GPU " : "CPU ") << std::left << std::setw(24) << h.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(9) << stats.p50 << std::setw(9) << stats.p95 << std::setw(9) << stats.p99 << std::endl;
+    }
+    out << std::defaultfloat;
+}
+
+bool FrameProfiler::exportChromeTrace(const char* path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    file << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < m_trace.size(); i++) {
+        const TraceEvent& event = m_trace[(m_traceNext + i) % m_trace.size()]; // Oldest first
+        file << ",\n{\"name\":\"";
+        for (const char* c = event.name; *c; c++) {
+            if (*c == '"' || *c == '\\') file << '\\';
+            file << *c;
+        }
+        file << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1)
+             << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+    }
+    file << "\n]}\n";
+    return (bool)file;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <ostream>
+#include <webgpu/webgpu.hpp>
+
+// Per-pass GPU timings from timestamp queries plus CPU scopes timed with Clock (glfwGetTimerValue).
+//
+// GPU timestamps are written around each pass with CommandEncoder::writeTimestamp, resolved
+// into a per-frame buffer and copied to a ring of mappable readback buffers. Those are mapped
+// asynchronously and consumed a few frames later, so the profiler never stalls the GPU or
+// the render loop: when every readback slot is still busy, the frame is simply not timed.
+// Timings go to a rolling history per scope name, for percentiles and Chrome trace export.
+class FrameProfiler {
+public:
+    struct Stats {
+        size_t samples = 0;
+        double min = 0.0; // Milliseconds
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    // The device must have been created with FeatureName::TimestampQuery for GPU timings,
+    // otherwise only CPU scopes are recorded.
+    FrameProfiler(wgpu::Device device, uint32_t maxPassesPerFrame = 16, uint32_t readbackFrames = 4, size_t historySize = 512);
+    ~FrameProfiler();
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    // Call before encoding. Consumes the readback slots whose mapping completed.
+    void beginFrame();
+    // GPU scope, wrap a whole render/compute pass with these on the encoder that records it
+    uint32_t beginPass(wgpu::CommandEncoder encoder, const char* name);
+    void endPass(wgpu::CommandEncoder encoder, uint32_t scope);
+    // Call on the frame's last encoder, before finish()
+    void resolve(wgpu::CommandEncoder encoder);
+    // Call after the frame was submitted, starts mapping its readback buffer
+    void endFrame();
+    // Blocks until the GPU timings of every submitted frame are read back
+    void flush();
+    // Drops all recorded samples and trace events, e.g. at the end of a warm-up phase
+    void reset();
+
+    // CPU scopes, name must outlive the profiler (string literals)
+    uint32_t beginCpu(const char* name);
+    void endCpu(uint32_t scope);
+
+    Stats gpuStats(const char* name) const;
+    Stats cpuStats(const char* name) const;
+    void printSummary(std::ostream& out) const;
+    // Chrome trace event format (chrome://tracing, ui.perfetto.dev). GPU scopes go on their
+    // own track, aligned so that each frame's first GPU timestamp starts with its CPU frame.
+    bool exportChromeTrace(const char* path) const;
+
+    bool gpuTimingSupported() const { return m_querySet != nullptr; }
+    // Nanoseconds per timestamp tick. wgpu-native does not expose the queue's timestamp
+    // period, 1.0 matches most Vulkan/D3D12 drivers.
+    double timestampPeriod = 1.0;
+
+private:
+    struct PassScope {
+        const char* name;
+        uint32_t firstQuery;
+    };
+    struct ReadbackSlot;
+    struct History {
+        const char* name;
+        bool gpu;
+        std::vector<double> samples; // Ring, milliseconds
+        size_t next = 0;
+        size_t count = 0;
+    };
+    struct TraceEvent {
+        const char* name;
+        bool gpu;
+        double start; // Microseconds since the profiler was created
+        double duration;
+    };
+
+    History& history(const char* name, bool gpu);
+    const History* findHistory(const char* name, bool gpu) const;
+    void addSample(const char* name, bool gpu, double start, double duration);
+    void readBack(ReadbackSlot& slot);
+    double cpuMicroseconds(uint64_t ticks) const;
+
+    wgpu::Device m_device;
+    wgpu::QuerySet m_querySet = nullptr;
+    uint32_t m_maxPasses;
+    size_t m_historySize;
+    std::vector<std::unique_ptr<ReadbackSlot>> m_slots;
+    ReadbackSlot* m_current = nullptr;
+    uint64_t m_frame = 0;
+    uint64_t m_frameStart = 0;
+    uint64_t m_origin = 0;
+    double m_timerFrequency;
+
+    struct CpuScope {
+        const char* name;
+        uint64_t start;
+    };
+    std::vector<CpuScope> m_cpuScopes;
+    std::vector<History> m_histories;
+    std::vector<TraceEvent> m_trace; // Ring of the most recent events
+    size_t m_traceNext = 0;
+    size_t m_traceCapacity = 1 << 16;
+};
+
+// Times the enclosing C++ scope on the CPU
+class ProfileScope {
+public:
+    ProfileScope(FrameProfiler& profiler, const char* name) : m_profiler(profiler), m_scope(profiler.beginCpu(name)) {}
+    ~ProfileScope() { m_profiler.endCpu(m_scope); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+    FrameProfiler& m_profiler;
+    uint32_t m_scope;
+};
@@ -0,0 +1,70 @@
+#include "FrameRing.h"
+#include <cassert>
+
+using namespace wgpu;
+
+FrameRing::FrameRing(Fence& fence, uint32_t framesInFlight) : m_fence(fence), m_device(fence.getDevice()) {
+    assert(framesInFlight > 0);
+    m_slots.resize(framesInFlight);
+}
+
+FrameRing::~FrameRing() {
+    waitIdle();
+    for (Slot& slot : m_slots) {
+        for (TransientBuffer& transient : slot.buffers) {
+            transient.buffer.destroy();
+            transient.buffer.release();
+        }
+    }
+}
+
+void FrameRing::retire(Slot& slot) {
+    m_fence.wait(slot.submission);
+    for (BindGroup& bindGroup : slot.bindGroups) bindGroup.release();
+    slot.bindGroups.clear();
+    for (TransientBuffer& transient : slot.buffers) transient.used = false;
+}
+
+void FrameRing::beginFrame() {
+    if (m_began) {
+        m_current = (m_current + 1) % framesInFlight();
+        m_frameIndex++;
+    }
+    m_began = true;
+    retire(m_slots[m_current]);
+    m_fence.collect();
+}
+
+SubmissionIndex FrameRing::submit(uint32_t commandCount, CommandBuffer const * commands) {
+    Slot& slot = m_slots[m_current];
+    slot.submission = m_fence.signal(commandCount, commands);
+    return slot.submission;
+}
+
+void FrameRing::waitIdle() {
+    for (Slot& slot : m_slots) retire(slot);
+}
+
+Buffer FrameRing::acquireBuffer(const BufferDescriptor& descriptor) {
+    assert(!descriptor.mappedAtCreation);
+    Slot& slot = m_slots[m_current];
+    for (TransientBuffer& transient : slot.buffers) {
+        if (!transient.used && transient.usage == descriptor.usage && transient.size >= descriptor.size) {
+            transient.used = true;
+            return transient.buffer;
+        }
+    }
+    TransientBuffer transient;
+    transient.buffer = m_device.createBuffer(descriptor);
+    transient.size   = descriptor.size;
+    transient.usage  = descriptor.usage;
+    transient.used   = true;
+    slot.buffers.push_back(transient);
+    return transient.buffer;
+}
+
+BindGroup FrameRing::createBindGroup(const BindGroupDescriptor& descriptor) {
+    BindGroup bindGroup = m_device.createBindGroup(descriptor);
+    m_slots[m_current].bindGroups.push_back(bindGroup);
+    return bindGroup;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+// Ring of N frames in flight. beginFrame() blocks on the fence until the oldest frame's
+// submission has retired on the GPU, which bounds how far ahead the CPU can run, then recycles
+// that frame's transient buffers and bind groups for the new frame.
+class FrameRing {
+public:
+    FrameRing(wgpu::Fence& fence, uint32_t framesInFlight = 2);
+    ~FrameRing();
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    void beginFrame();
+    wgpu::SubmissionIndex submit(uint32_t commandCount, wgpu::CommandBuffer const * commands);
+    void waitIdle();
+
+    // Transient buffer owned by the current frame. Buffers of a slot are reused by later frames
+    // of the same slot when usage matches and size fits, so steady state allocates nothing.
+    // Fill them with Queue::writeBuffer, mappedAtCreation buffers cannot be recycled.
+    wgpu::Buffer acquireBuffer(const wgpu::BufferDescriptor& descriptor);
+    // Bind group owned by the current frame, released once the frame retires.
+    wgpu::BindGroup createBindGroup(const wgpu::BindGroupDescriptor& descriptor);
+
+    uint32_t framesInFlight() const { return (uint32_t)m_slots.size(); }
+    uint32_t slotIndex() const { return m_current; }
+    uint64_t frameIndex() const { return m_frameIndex; }
+
+private:
+    struct TransientBuffer {
+        wgpu::Buffer buffer = nullptr;
+        uint64_t size = 0;
+        WGPUBufferUsageFlags usage = 0;
+        bool used = false;
+    };
+    struct Slot {
+        wgpu::SubmissionIndex submission = 0;
+        std::vector<TransientBuffer> buffers;
+        std::vector<wgpu::BindGroup> bindGroups;
+    };
+
+    void retire(Slot& slot);
+
+    wgpu::Fence& m_fence;
+    wgpu::Device m_device;
+    std::vector<Slot> m_slots;
+    uint32_t m_current = 0;
+    uint64_t m_frameIndex = 0;
+    bool m_began = false;
+};
@@ -0,0 +1,209 @@
+#include "GpuCulling.h"
+#include "ShaderCache.h"
+#include "PipelineCache.h"
+#include "RenderPassRecorder.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+using namespace wgpu;
+
+static const uint32_t WorkgroupSize = 64; // @workgroup_size in cull.wgsl
+static const uint64_t DrawArgsSize = 5 * sizeof(uint32_t); // DrawIndexedIndirect arguments
+
+static FeatureName nativeFeature(WGPUNativeFeature feature) {
+    return (WGPUFeatureName)feature;
+}
+
+GpuCulling::GpuCulling(uint32_t maxObjects) : m_maxObjects(std::max(1u, maxObjects)) {
+    m_cpuObjects.reserve(m_maxObjects);
+    m_live.reserve(m_maxObjects);
+}
+
+GpuCulling::~GpuCulling() {
+    if (m_bindGroup) m_bindGroup.release();
+    for (Buffer* buffer : { &m_params, &m_objects, &m_draws, &m_drawCount }) {
+        if (!*buffer) continue;
+        buffer->destroy();
+        buffer->release();
+    }
+}
+
+bool GpuCulling::supported(Device device) {
+    return device.hasFeature(FeatureName::IndirectFirstInstance);
+}
+
+bool GpuCulling::initialize(SceneResources resources) {
+    Device device = resources.device;
+    if (!supported(device)) {
+        std::cerr << "GPU culling needs the IndirectFirstInstance feature" << std::endl;
+        return false;
+    }
+    if (device.hasFeature(nativeFeature(NativeFeature::MultiDrawIndirectCount))) {
+        m_mode = Mode::MultiDrawCount;
+    } else if (device.hasFeature(nativeFeature(NativeFeature::MultiDrawIndirect))) {
+        m_mode = Mode::MultiDraw;
+    } else {
+        m_mode = Mode::SingleDraws;
+    }
+
+    ShaderModule shaderModule = resources.shaders.load("cull.wgsl");
+    if (!shaderModule) return false;
+    ComputePipelineDescriptor pipelineDesc = ComputePipelineDescriptor();
+    pipelineDesc.nextInChain           = nullptr;
+    pipelineDesc.label                 = "Culling";
+    pipelineDesc.layout                = nullptr;
+    pipelineDesc.compute.nextInChain   = nullptr;
+    pipelineDesc.compute.module        = shaderModule;
+    pipelineDesc.compute.entryPoint    = "cs_main";
+    pipelineDesc.compute.constantCount = 0;
+    pipelineDesc.compute.constants     = nullptr;
+    m_pipeline = resources.pipelines.wait(pipelineDesc);
+    if (!m_pipeline) return false;
+
+    BufferDescriptor bufferDesc;
+    bufferDesc.mappedAtCreation = false;
+    bufferDesc.label = "Culling params";
+    bufferDesc.size  = sizeof(Params);
+    bufferDesc.usage = BufferUsage::Uniform | BufferUsage::CopyDst;
+    m_params = device.createBuffer(bufferDesc);
+    bufferDesc.label = "Culling objects";
+    bufferDesc.size  = (uint64_t)m_maxObjects * sizeof(Object);
+    bufferDesc.usage = BufferUsage::Storage | BufferUsage::CopyDst;
+    m_objects = device.createBuffer(bufferDesc);
+    bufferDesc.label = "Culled draws";
+    bufferDesc.size  = (uint64_t)m_maxObjects * DrawArgsSize;
+    bufferDesc.usage = BufferUsage::Storage | BufferUsage::Indirect;
+    m_draws = device.createBuffer(bufferDesc);
+    bufferDesc.label = "Culled draw count";
+    bufferDesc.size  = sizeof(uint32_t);
+    bufferDesc.usage = BufferUsage::Storage | BufferUsage::Indirect | BufferUsage::CopyDst;
+    m_drawCount = device.createBuffer(bufferDesc);
+    if (!m_params || !m_objects || !m_draws || !m_drawCount) return false;
+
+    std::vector<BindGroupEntry> entries(4, BindGroupEntry());
+    Buffer buffers[] = { m_params, m_objects, m_draws, m_drawCount };
+    for (uint32_t i = 0; i < 4; i++) {
+        entries[i].nextInChain = nullptr;
+        entries[i].binding     = i;
+        entries[i].buffer      = buffers[i];
+        entries[i].offset      = 0;
+        entries[i].size        = buffers[i].getSize();
+        entries[i].sampler     = nullptr;
+        entries[i].textureView = nullptr;
+    }
+    BindGroupLayout layout = m_pipeline.getBindGroupLayout(0);
+    BindGroupDescriptor bindGroupDesc = BindGroupDescriptor();
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label       = "Culling";
+    bindGroupDesc.layout      = layout;
+    bindGroupDesc.entryCount  = (uint32_t)entries.size();
+    bindGroupDesc.entries     = entries.data();
+    m_bindGroup = device.createBindGroup(bindGroupDesc);
+    layout.release();
+    return m_bindGroup != nullptr;
+}
+
+uint32_t GpuCulling::add(const Object& object) {
+    uint32_t id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else if (m_cpuObjects.size() < m_maxObjects) {
+        id = (uint32_t)m_cpuObjects.size();
+        m_cpuObjects.emplace_back();
+        m_live.push_back(false);
+    } else {
+        return UINT32_MAX;
+    }
+    m_live[id] = true;
+    update(id, object);
+    return id;
+}
+
+void GpuCulling::update(uint32_t id, const Object& object) {
+    assert(m_live[id]);
+    if (!m_live[id]) return;
+    write(id, object);
+}
+
+void GpuCulling::write(uint32_t id, const Object& object) {
+    m_cpuObjects[id] = object;
+    m_dirtyBegin = std::min(m_dirtyBegin, id);
+    m_dirtyEnd = std::max(m_dirtyEnd, id + 1);
+}
+
+void GpuCulling::remove(uint32_t id) {
+    assert(m_live[id]);
+    if (!m_live[id]) return; // Already removed, its id must not be handed out twice
+    Object removed;
+    removed.radius = -1.0f; // Always culled, the shader skips negative radii
+    write(id, removed);
+    m_live[id] = false;
+    m_freeIds.push_back(id);
+}
+
+void GpuCulling::update(Queue queue, const float viewProjection[16]) {
+    if (m_dirtyBegin < m_dirtyEnd) {
+        // One write of the changed range, objects rarely change all over the buffer at once
+        queue.writeBuffer(m_objects, (uint64_t)m_dirtyBegin * sizeof(Object), &m_cpuObjects[m_dirtyBegin],
+                          (size_t)(m_dirtyEnd - m_dirtyBegin) * sizeof(Object));
+        m_dirtyBegin = UINT32_MAX;
+        m_dirtyEnd = 0;
+    }
+
+    // Gribb-Hartmann planes of a column-major matrix with WebGPU's [0, 1] clip depth
+    auto row = [viewProjection](int r, int c) { return viewProjection[4 * c + r]; };
+    static const int rows[6] = { 0, 0, 1, 1, 2, 2 };
+    static const float signs[6] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+    Params params;
+    for (int p = 0; p < 6; p++) {
+        float length = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            float w = p == 4 ? 0.0f : row(3, c); // Near is z >= 0, not z >= -w
+            params.planes[p][c] = w + signs[p] * row(rows[p], c);
+            if (c < 3) length += params.planes[p][c] * params.planes[p][c];
+        }
+        length = std::sqrt(length);
+        if (length > 0.0f) {
+            for (int c = 0; c < 4; c++) params.planes[p][c] /= length;
+        }
+    }
+    params.objectCount = objectCount();
+    params.compact = m_mode == Mode::MultiDrawCount ? 1 : 0;
+    params.padding[0] = params.padding[1] = 0;
+    queue.writeBuffer(m_params, 0, &params, sizeof(params));
+    m_culledCount = params.objectCount;
+}
+
+void GpuCulling::cull(CommandEncoder encoder) {
+    if (m_culledCount == 0) return;
+    if (m_mode == Mode::MultiDrawCount) encoder.clearBuffer(m_drawCount, 0, sizeof(uint32_t));
+    ComputePassDescriptor passDesc = ComputePassDescriptor();
+    passDesc.nextInChain         = nullptr;
+    passDesc.label               = "Culling";
+    passDesc.timestampWriteCount = 0;
+    passDesc.timestampWrites     = nullptr;
+    ComputePassEncoder pass = encoder.beginComputePass(passDesc);
+    pass.setPipeline(m_pipeline);
+    pass.setBindGroup(0, m_bindGroup, 0, nullptr);
+    pass.dispatchWorkgroups((m_culledCount + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+    pass.end();
+    pass.release();
+}
+
+void GpuCulling::draw(RenderPassRecorder& renderPass) {
+    if (m_culledCount == 0) return;
+    switch (m_mode) {
+    case Mode::MultiDrawCount:
+        renderPass.multiDrawIndexedIndirectCount(m_draws, 0, m_drawCount, 0, m_culledCount);
+        break;
+    case Mode::MultiDraw:
+        renderPass.multiDrawIndexedIndirect(m_draws, 0, m_culledCount);
+        break;
+    case Mode::SingleDraws:
+        for (uint32_t i = 0; i < m_culledCount; i++) renderPass.drawIndexedIndirect(m_draws, i * DrawArgsSize);
+        break;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+#include "Scene.h"
+
+class RenderPassRecorder;
+
+// Frustum culling on the GPU, for scenes that draw every object with a single call.
+//
+// Objects are bounding spheres with the indexed draw that renders them, kept in a storage
+// buffer where only the objects changed since the last frame are uploaded. update() writes
+// the frustum planes, cull() records a compute pass that tests every object and appends the
+// draw arguments of the visible ones to an indirect buffer, counting them with an atomic, and
+// draw() issues one multiDrawIndexedIndirectCount for all of them. The CPU cost per frame does
+// not depend on the object count. Each draw's firstInstance is the object's id, for vertex
+// shaders to fetch per-object data, e.g. from objects().
+//
+// Without NativeFeature::MultiDrawIndirectCount culled objects keep their slot with an instance
+// count of zero and everything is drawn with multiDrawIndexedIndirect, or with one
+// drawIndexedIndirect per object when MultiDrawIndirect is missing too. The device must have
+// FeatureName::IndirectFirstInstance, see supported().
+class GpuCulling {
+public:
+    enum class Mode { MultiDrawCount, MultiDraw, SingleDraws };
+
+    // Matches struct Object in cull.wgsl
+    struct Object {
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float radius = 0.0f;
+        uint32_t indexCount = 0;
+        uint32_t firstIndex = 0;
+        int32_t baseVertex = 0;
+        uint32_t padding = 0;
+    };
+
+    explicit GpuCulling(uint32_t maxObjects);
+    ~GpuCulling();
+    GpuCulling(const GpuCulling&) = delete;
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    static bool supported(wgpu::Device device);
+    bool initialize(SceneResources resources);
+
+    // Returns the object's id, UINT32_MAX when all maxObjects are in use. update() and remove()
+    // ignore ids already removed.
+    uint32_t add(const Object& object);
+    void update(uint32_t id, const Object& object);
+    void remove(uint32_t id);
+
+    // Uploads the changed objects and the frustum of a column-major view-projection matrix
+    void update(wgpu::Queue queue, const float viewProjection[16]);
+    // Records the culling compute pass, before the pass that calls draw()
+    void cull(wgpu::CommandEncoder encoder);
+    // Draws the visible objects with the pipeline, bind groups and index buffer set on the pass
+    void draw(RenderPassRecorder& renderPass);
+
+    wgpu::Buffer objects() const { return m_objects; }
+    uint32_t objectCount() const { return (uint32_t)m_cpuObjects.size(); }
+    uint32_t maxObjects() const { return m_maxObjects; }
+    Mode mode() const { return m_mode; }
+
+private:
+    void write(uint32_t id, const Object& object); // Marks it for upload
+
+    // Matches struct Params in cull.wgsl
+    struct Params {
+        float planes[6][4];
+        uint32_t objectCount;
+        uint32_t compact;
+        uint32_t padding[2];
+    };
+
+    uint32_t m_maxObjects;
+    Mode m_mode = Mode::SingleDraws;
+    std::vector<Object> m_cpuObjects;
+    std::vector<bool> m_live;
+    std::vector<uint32_t> m_freeIds;
+    uint32_t m_dirtyBegin = UINT32_MAX;
+    uint32_t m_dirtyEnd = 0;
+    uint32_t m_culledCount = 0; // Objects the last update() sent to the GPU
+
+    wgpu::ComputePipeline m_pipeline = nullptr; // Owned by the PipelineCache
+    wgpu::BindGroup m_bindGroup = nullptr;
+    wgpu::Buffer m_params = nullptr;
+    wgpu::Buffer m_objects = nullptr;
+    wgpu::Buffer m_draws = nullptr;
+    wgpu::Buffer m_drawCount = nullptr;
+};
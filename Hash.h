@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// 64 bit FNV-1a, continue a hash by passing it as the seed
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
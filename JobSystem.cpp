@@ -0,0 +1,224 @@
+#include "JobSystem.h"
+
+struct JobSystem::Worker {
+    WorkStealingDeque<Job, MaxJobsPerThread> deque;
+    std::unique_ptr<Job[]> jobs{ new Job[MaxJobsPerThread] };
+    uint32_t nextJob = 0;
+    uint32_t random = 0; // Where to start looking for a victim
+    std::atomic<uint64_t> executed{ 0 };
+    std::atomic<uint64_t> stolen{ 0 };
+    std::atomic<uint64_t> inlined{ 0 };
+};
+
+namespace {
+// The pool of the current thread and its worker index in it, unset outside of pools
+thread_local const JobSystem* t_system = nullptr;
+thread_local uint32_t t_index = 0;
+
+constexpr uint32_t SpinsBeforeSleep = 64;
+} // namespace
+
+JobSystem::JobSystem(uint32_t threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t i = 0; i < threadCount + 1; i++) m_workers.push_back(std::make_unique<Worker>());
+    for (uint32_t i = 0; i < (uint32_t)m_workers.size(); i++) m_workers[i]->random = 2654435761u * (i + 1);
+    t_system = this;
+    t_index = 0;
+    for (uint32_t i = 1; i < threadCount; i++) m_threads.emplace_back([this, i]() { workerMain(i); });
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_quit = true;
+        m_epoch++;
+    }
+    m_wakeUp.notify_all();
+    for (std::thread& thread : m_threads) thread.join();
+    pumpMainThread();
+    if (t_system == this) t_system = nullptr;
+}
+
+bool JobSystem::isMainThread() const {
+    return t_system == this && t_index == 0;
+}
+
+JobSystem::Worker* JobSystem::currentWorker() const {
+    return t_system == this ? m_workers[t_index].get() : nullptr;
+}
+
+Job* JobSystem::allocate() {
+    Worker* worker = currentWorker();
+    std::unique_lock<std::mutex> lock(m_externalMutex, std::defer_lock);
+    if (!worker) {
+        worker = m_workers.back().get();
+        lock.lock();
+    }
+    Job& job = worker->jobs[worker->nextJob % MaxJobsPerThread];
+    if (job.pending.load(std::memory_order_acquire)) {
+        worker->inlined.fetch_add(1, std::memory_order_relaxed);
+        return nullptr; // Every slot is in flight
+    }
+    worker->nextJob++;
+    job.pending.store(true, std::memory_order_relaxed);
+    return &job;
+}
+
+void JobSystem::submit(Job* job, JobCounter* after) {
+    if (after) {
+        std::lock_guard<std::mutex> lock(after->m_mutex);
+        if (after->m_value.load(std::memory_order_acquire) != 0) {
+            after->m_waiting.push_back(job); // Started by the job that finishes the counter
+            return;
+        }
+    }
+    push(job);
+}
+
+void JobSystem::push(Job* job) {
+    Worker* worker = currentWorker();
+    bool pushed;
+    if (worker) {
+        pushed = worker->deque.push(job);
+    } else {
+        worker = m_workers.back().get();
+        std::lock_guard<std::mutex> lock(m_externalMutex);
+        pushed = worker->deque.push(job);
+    }
+    if (!pushed) {
+        worker->inlined.fetch_add(1, std::memory_order_relaxed);
+        execute(job);
+        return;
+    }
+    wake();
+}
+
+void JobSystem::wake() {
+    // Pairs with the fence of a worker going to sleep: either it sees the job, or this sees it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed) == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_epoch++;
+    }
+    m_wakeUp.notify_one();
+}
+
+void JobSystem::execute(Job* job) {
+    JobCounter* counter = job->counter;
+    job->invoke(*job);
+    job->pending.store(false, std::memory_order_release); // The slot may be reused from here on
+    if (Worker* worker = currentWorker()) worker->executed.fetch_add(1, std::memory_order_relaxed);
+    if (counter) finish(*counter);
+}
+
+void JobSystem::finish(JobCounter& counter) {
+    uint32_t value = counter.m_value.load(std::memory_order_relaxed);
+    while (true) {
+        // The last job marks the counter instead of zeroing it, so that wait() cannot return
+        // and free it while the waiting jobs are still being taken from it
+        uint32_t next = value == 1 ? JobCounter::Releasing : value - 1;
+        if (counter.m_value.compare_exchange_weak(value, next, std::memory_order_acq_rel, std::memory_order_relaxed)) break;
+    }
+    if (value != 1) return;
+    std::vector<Job*> waiting;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        waiting.swap(counter.m_waiting);
+        counter.m_value.store(0, std::memory_order_release);
+    }
+    for (Job* job : waiting) push(job); // The counter may be gone already
+}
+
+Job* JobSystem::findJob(Worker* self) {
+    if (self) {
+        if (Job* job = self->deque.pop()) return job;
+    }
+    uint32_t count = (uint32_t)m_workers.size();
+    uint32_t start = 0;
+    if (self) {
+        self->random ^= self->random << 13;
+        self->random ^= self->random >> 17;
+        self->random ^= self->random << 5;
+        start = self->random % count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        Worker* victim = m_workers[(start + i) % count].get();
+        if (victim == self) continue;
+        if (Job* job = victim->deque.steal()) {
+            if (self) self->stolen.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    Worker* self = currentWorker();
+    bool mainThread = isMainThread();
+    while (counter.m_value.load(std::memory_order_acquire) != 0) {
+        if (Job* job = findJob(self)) {
+            execute(job);
+            continue;
+        }
+        if (mainThread) pumpMainThread();
+        std::this_thread::yield();
+    }
+    // The job that finished the counter may still hold its lock
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::pumpMainThread() {
+    std::vector<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mainMutex);
+        jobs.swap(m_mainJobs);
+    }
+    for (Job* job : jobs) execute(job);
+}
+
+void JobSystem::workerMain(uint32_t index) {
+    t_system = this;
+    t_index = index;
+    Worker* self = m_workers[index].get();
+    uint32_t spins = 0;
+    while (true) {
+        if (Job* job = findJob(self)) {
+            execute(job);
+            spins = 0;
+            continue;
+        }
+        if (++spins < SpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        spins = 0;
+
+        // Announce the sleep before the last look, see wake()
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+        Job* job = findJob(self);
+        if (!job) {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wakeUp.wait(lock, [&]() { return m_quit || m_epoch.load(std::memory_order_relaxed) != epoch; });
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+        if (job) {
+            execute(job);
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        if (m_quit) break;
+    }
+    t_system = nullptr;
+}
+
+JobSystem::Stats JobSystem::stats() const {
+    Stats stats;
+    for (const auto& worker : m_workers) {
+        stats.executed += worker->executed.load(std::memory_order_relaxed);
+        stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+        stats.inlined += worker->inlined.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include "WorkStealingDeque.h"
+
+class JobSystem;
+struct Job;
+
+// Counts the unfinished jobs started with it. Jobs can be made to wait for a counter instead
+// of blocking a thread on it. Only destroy a counter once JobSystem::wait() returned for it.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+private:
+    friend class JobSystem;
+    static constexpr uint32_t Releasing = 0x80000000u; // The last job is starting the jobs waiting for the counter
+
+    std::atomic<uint32_t> m_value{ 0 };
+    std::mutex m_mutex;
+    std::vector<Job*> m_waiting; // Jobs that run once the counter reaches zero
+};
+
+// Where the captures of JobSystem::run() are stored, one per job in flight.
+struct Job {
+    static constexpr size_t StorageSize = 48;
+
+    void (*invoke)(Job& job) = nullptr; // Runs then destroys the stored function
+    JobCounter* counter = nullptr;
+    std::atomic<bool> pending{ false }; // Between run() and the end of the job
+    alignas(std::max_align_t) unsigned char storage[StorageSize];
+};
+
+// Work-stealing thread pool for short engine tasks: culling, animation, uploads, recording.
+//
+// Every thread of the pool, the one that created it included, owns a Chase-Lev deque. Jobs
+// run() on a pool thread go to its own deque, where it picks them back up newest first, while
+// idle threads steal the oldest ones from the others. Threads outside the pool share one more
+// deque behind a mutex. Jobs are allocated from a per-thread ring without locks or heap
+// allocations, and run inline when the ring or deque is full. Idle workers spin briefly, then
+// sleep until new work is pushed.
+//
+// Dependencies go through JobCounters: run() increments the counter passed to it, finishing
+// the job decrements it, and a job run with an `after` counter is only started once that one
+// reaches zero. wait() runs other jobs until a counter reaches zero instead of blocking.
+// Jobs run with runOnMainThread() only execute on the thread that created the pool, for APIs
+// like GLFW that must be called from it, when it calls wait() or pumpMainThread().
+class JobSystem {
+public:
+    static constexpr size_t MaxJobsPerThread = 4096;
+
+    struct Stats {
+        uint64_t executed = 0;
+        uint64_t stolen = 0;
+        uint64_t inlined = 0; // Ran by run() itself because the ring or deque was full
+    };
+
+    // threadCount includes the calling thread, 0 uses one thread per hardware thread
+    explicit JobSystem(uint32_t threadCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // function is called without arguments and its captures must fit in Job::StorageSize bytes
+    template <typename F>
+    void run(F&& function, JobCounter* counter = nullptr, JobCounter* after = nullptr);
+    template <typename F>
+    void runOnMainThread(F&& function, JobCounter* counter = nullptr);
+    // Calls function(i) for i in [0, count) in batches of at least grain
+    template <typename F>
+    void parallelFor(uint32_t count, uint32_t grain, F&& function);
+
+    // Runs jobs until the counter reaches zero
+    void wait(JobCounter& counter);
+    // Main thread only, runs the jobs queued with runOnMainThread()
+    void pumpMainThread();
+    // Called by the thread that queues a main thread job, e.g. to post an empty GLFW event.
+    // Set it before other threads use the pool.
+    void setMainThreadWakeUp(std::function<void()> wakeUp) { m_wakeMainThread = std::move(wakeUp); }
+
+    uint32_t threadCount() const { return (uint32_t)m_threads.size() + 1; }
+    Stats stats() const;
+
+private:
+    struct Worker;
+
+    template <typename F>
+    Job* prepare(F&& function, JobCounter* counter);
+    Job* allocate();
+    void submit(Job* job, JobCounter* after);
+    void push(Job* job);
+    void execute(Job* job);
+    void finish(JobCounter& counter);
+    Job* findJob(Worker* self);
+    void wake();
+    void workerMain(uint32_t index);
+    bool isMainThread() const;
+    Worker* currentWorker() const; // Null on threads outside the pool
+
+    std::vector<std::unique_ptr<Worker>> m_workers; // Main thread first, then the pool's threads, then the shared one
+    std::vector<std::thread> m_threads;
+    std::mutex m_externalMutex; // Guards the shared worker, for threads outside the pool
+
+    std::mutex m_mainMutex;
+    std::vector<Job*> m_mainJobs;
+    std::function<void()> m_wakeMainThread;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    std::atomic<uint32_t> m_sleeping{ 0 };
+    std::atomic<uint64_t> m_epoch{ 0 }; // Bumped when work is pushed while workers sleep
+    bool m_quit = false;
+};
+
+template <typename F>
+Job* JobSystem::prepare(F&& function, JobCounter* counter) {
+    using Function = std::decay_t<F>;
+    static_assert(sizeof(Function) <= Job::StorageSize, "Job captures too large, capture a pointer to them instead");
+    static_assert(alignof(Function) <= alignof(std::max_align_t), "Job captures over-aligned");
+    Job* job = allocate();
+    if (!job) return nullptr;
+    new (job->storage) Function(std::forward<F>(function));
+    job->invoke = [](Job& job) {
+        Function* stored = std::launder(reinterpret_cast<Function*>(job.storage));
+        (*stored)();
+        stored->~Function();
+    };
+    job->counter = counter;
+    if (counter) counter->m_value.fetch_add(1, std::memory_order_relaxed);
+    return job;
+}
+
+template <typename F>
+void JobSystem::run(F&& function, JobCounter* counter, JobCounter* after) {
+    Job* job = prepare(std::forward<F>(function), counter);
+    if (job) {
+        submit(job, after);
+        return;
+    }
+    if (after) wait(*after);
+    function();
+}
+
+template <typename F>
+void JobSystem::runOnMainThread(F&& function, JobCounter* counter) {
+    Job* job = prepare(std::forward<F>(function), counter);
+    if (!job && isMainThread()) {
+        function();
+        return;
+    }
+    while (!job) {
+        std::this_thread::yield(); // Ring full, wait for some of this thread's jobs to finish
+        job = prepare(std::forward<F>(function), counter);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mainMutex);
+        m_mainJobs.push_back(job);
+    }
+    if (m_wakeMainThread) m_wakeMainThread();
+}
+
+template <typename F>
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, F&& function) {
+    if (grain == 0) grain = 1;
+    JobCounter counter;
+    for (uint32_t first = 0; first < count; first += grain) {
+        uint32_t last = std::min(count, first + grain);
+        run([&function, first, last]() {
+            for (uint32_t i = first; i < last; i++) function(i);
+        }, &counter);
+    }
+    wait(counter);
+}
@@ -0,0 +1,42 @@
+#include "ParallelRecorder.h"
+#include "RenderPassRecorder.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace wgpu;
+
+ParallelRecorder::ParallelRecorder(JobSystem& jobs, Fence& fence, TextureFormat colorFormat, TextureFormat depthStencilFormat, uint32_t sampleCount)
+    : m_jobs(jobs), m_fence(fence), m_device(fence.getDevice()), m_colorFormat(colorFormat) {
+    m_bundleEncoderDesc = RenderBundleEncoderDescriptor();
+    m_bundleEncoderDesc.nextInChain        = nullptr;
+    m_bundleEncoderDesc.label              = "Parallel draws";
+    m_bundleEncoderDesc.colorFormatsCount  = 1;
+    m_bundleEncoderDesc.colorFormats       = &m_colorFormat;
+    m_bundleEncoderDesc.depthStencilFormat = depthStencilFormat;
+    m_bundleEncoderDesc.sampleCount        = sampleCount;
+    m_bundleEncoderDesc.depthReadOnly      = false;
+    m_bundleEncoderDesc.stencilReadOnly    = false;
+}
+
+void ParallelRecorder::record(RenderPassRecorder& renderPass, const DrawQueue::Draw* const* draws, uint32_t count) {
+    if (count == 0) return;
+    uint32_t chunkCount = std::min(m_jobs.threadCount(), (count + m_minDrawsPerBundle - 1) / m_minDrawsPerBundle);
+    uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    chunkCount = (count + chunkSize - 1) / chunkSize; // Rounding up the size may leave chunks empty
+    m_bundles.assign(chunkCount, nullptr);
+    m_jobs.parallelFor(chunkCount, 1, [&](uint32_t chunk) {
+        uint32_t first = chunk * chunkSize;
+        uint32_t last = std::min(count, first + chunkSize);
+        assert(first < last);
+        RenderBundleEncoder encoder = m_device.createRenderBundleEncoder(m_bundleEncoderDesc);
+        encodeDraws(encoder, draws + first, last - first);
+        RenderBundleDescriptor bundleDesc;
+        bundleDesc.nextInChain = nullptr;
+        bundleDesc.label       = "Parallel draws";
+        m_bundles[chunk] = encoder.finish(bundleDesc);
+        encoder.release();
+    });
+    renderPass.executeBundles(chunkCount, m_bundles.data());
+    for (RenderBundle bundle : m_bundles) m_fence.releaseAfter(m_fence.lastSignaled() + 1, bundle); // Submitted with the frame
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+#include "DrawQueue.h"
+
+class RenderPassRecorder;
+class JobSystem;
+
+// Records command streams on several threads, with results that do not depend on the timing.
+//
+// record() splits a pass's draw list into contiguous chunks, records each chunk into its own
+// RenderBundleEncoder in a job (the calling thread takes a share) and executes the bundles
+// in chunk order, so the pass draws exactly what a single-threaded replay would. Each bundle
+// starts without state, which costs one pipeline and bind group set per chunk; chunks are
+// kept large enough for that to stay small. The bundles are released once the submission of
+// the frame being recorded has retired.
+class ParallelRecorder {
+public:
+    ParallelRecorder(JobSystem& jobs, wgpu::Fence& fence, wgpu::TextureFormat colorFormat,
+                     wgpu::TextureFormat depthStencilFormat = wgpu::TextureFormat::Undefined, uint32_t sampleCount = 1);
+    ParallelRecorder(const ParallelRecorder&) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+    void record(RenderPassRecorder& renderPass, const DrawQueue::Draw* const* draws, uint32_t count);
+
+    void setMinDrawsPerBundle(uint32_t draws) { m_minDrawsPerBundle = draws > 0 ? draws : 1; }
+
+private:
+    JobSystem& m_jobs;
+    wgpu::Fence& m_fence;
+    wgpu::Device m_device;
+    WGPUTextureFormat m_colorFormat;
+    wgpu::RenderBundleEncoderDescriptor m_bundleEncoderDesc;
+    uint32_t m_minDrawsPerBundle = 512;
+    std::vector<wgpu::RenderBundle> m_bundles;
+};
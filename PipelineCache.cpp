@@ -0,0 +1,191 @@
+#include "PipelineCache.h"
+#include "PipelineManifest.h"
+#include "PipelineSerializer.h"
+#include "Hash.h"
+#include <iostream>
+
+using namespace wgpu;
+
+PipelineCache::PipelineCache(Device device, Fallback fallback) : m_device(device), m_fallback(fallback) {
+    m_scratch.reserve(512);
+}
+
+PipelineCache::~PipelineCache() {
+    flush(); // Callbacks reference the entries
+    for (Entry& entry : m_entries) {
+        if (entry.pipeline) entry.pipeline.release();
+        if (entry.computePipeline) entry.computePipeline.release();
+        for (WGPUShaderModule module : entry.modules) {
+            if (module) ShaderModule(module).release();
+        }
+        if (entry.layout) PipelineLayout(entry.layout).release();
+    }
+}
+
+template <typename Descriptor>
+uint32_t PipelineCache::lookup(std::unique_lock<std::mutex>& lock, const Descriptor& descriptor, bool& created) {
+    m_scratch.clear();
+    PipelineWriter(m_scratch).write(descriptor);
+    uint64_t hash = hashBytes(m_scratch.data(), m_scratch.size());
+
+    created = false;
+    auto it = m_byHash.find(hash);
+    uint32_t last = UINT32_MAX;
+    if (it != m_byHash.end()) {
+        for (uint32_t index = it->second; index != UINT32_MAX; index = m_entries[index].nextWithHash) {
+            if (m_entries[index].key == m_scratch) return index;
+            last = index;
+        }
+    }
+
+    uint32_t index = (uint32_t)m_entries.size();
+    m_entries.emplace_back();
+    Entry& entry = m_entries.back();
+    entry.key = m_scratch;
+    std::string ignored;
+    PipelineWriter(ignored, &entry.modules).write(descriptor); // Collects the modules
+    for (WGPUShaderModule module : entry.modules) {
+        if (module) ShaderModule(module).reference();
+    }
+    entry.layout = descriptor.layout;
+    if (entry.layout) PipelineLayout(entry.layout).reference();
+    if (last == UINT32_MAX) m_byHash[hash] = index; else m_entries[last].nextWithHash = index;
+
+    created = true;
+    m_stats.misses++;
+    m_stats.pending++;
+    // Some backends call back right away, which takes the lock
+    lock.unlock();
+    compile(index, descriptor);
+    lock.lock();
+    return index;
+}
+
+template <typename Descriptor>
+void PipelineCache::use(Entry& entry, const Descriptor& descriptor) {
+    if (entry.used) return;
+    entry.used = true;
+    if (m_recorder) m_recorder->record(descriptor);
+}
+
+void PipelineCache::compile(uint32_t index, const RenderPipelineDescriptor& descriptor) {
+    m_device.createRenderPipelineAsync(descriptor, [this, index](CreatePipelineAsyncStatus status, RenderPipeline pipeline, char const * message) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry& entry = m_entries[index];
+        m_stats.pending--;
+        if (status == CreatePipelineAsyncStatus::Success) {
+            entry.state = Entry::State::Ready;
+            entry.pipeline = pipeline;
+        } else {
+            entry.state = Entry::State::Failed;
+            m_stats.failed++;
+            std::cerr << "Could not create pipeline: " << (message ? message : "unknown error") << std::endl;
+        }
+    });
+}
+
+void PipelineCache::compile(uint32_t index, const ComputePipelineDescriptor& descriptor) {
+    m_device.createComputePipelineAsync(descriptor, [this, index](CreatePipelineAsyncStatus status, ComputePipeline pipeline, char const * message) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry& entry = m_entries[index];
+        m_stats.pending--;
+        if (status == CreatePipelineAsyncStatus::Success) {
+            entry.state = Entry::State::Ready;
+            entry.computePipeline = pipeline;
+        } else {
+            entry.state = Entry::State::Failed;
+            m_stats.failed++;
+            std::cerr << "Could not create compute pipeline: " << (message ? message : "unknown error") << std::endl;
+        }
+    });
+}
+
+RenderPipeline PipelineCache::get(const RenderPipelineDescriptor& descriptor, RenderPipeline standIn) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool created;
+    Entry& entry = m_entries[lookup(lock, descriptor, created)];
+    use(entry, descriptor);
+    if (entry.state == Entry::State::Ready) {
+        if (!created) m_stats.hits++;
+        return entry.pipeline;
+    }
+    if (entry.state == Entry::State::Pending) m_stats.fallbacks++;
+    return m_fallback == Fallback::StandIn ? standIn : RenderPipeline(nullptr);
+}
+
+ComputePipeline PipelineCache::get(const ComputePipelineDescriptor& descriptor) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool created;
+    Entry& entry = m_entries[lookup(lock, descriptor, created)];
+    use(entry, descriptor);
+    if (entry.state == Entry::State::Ready) {
+        if (!created) m_stats.hits++;
+        return entry.computePipeline;
+    }
+    if (entry.state == Entry::State::Pending) m_stats.fallbacks++;
+    return nullptr; // Dispatches have no stand-in
+}
+
+void PipelineCache::waitFor(std::unique_lock<std::mutex>& lock, uint32_t index) {
+    while (m_entries[index].state == Entry::State::Pending) {
+        lock.unlock();
+        m_device.poll(true, nullptr);
+        lock.lock();
+    }
+}
+
+RenderPipeline PipelineCache::wait(const RenderPipelineDescriptor& descriptor) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool created;
+    uint32_t index = lookup(lock, descriptor, created);
+    use(m_entries[index], descriptor);
+    if (!created) m_stats.hits++;
+    waitFor(lock, index);
+    return m_entries[index].pipeline;
+}
+
+ComputePipeline PipelineCache::wait(const ComputePipelineDescriptor& descriptor) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool created;
+    uint32_t index = lookup(lock, descriptor, created);
+    use(m_entries[index], descriptor);
+    if (!created) m_stats.hits++;
+    waitFor(lock, index);
+    return m_entries[index].computePipeline;
+}
+
+void PipelineCache::prepare(const RenderPipelineDescriptor& descriptor) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool created;
+    lookup(lock, descriptor, created);
+}
+
+void PipelineCache::prepare(const ComputePipelineDescriptor& descriptor) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool created;
+    lookup(lock, descriptor, created);
+}
+
+bool PipelineCache::ready() {
+    if (stats().pending > 0) m_device.poll(false, nullptr);
+    return stats().pending == 0;
+}
+
+void PipelineCache::flush() {
+    while (stats().pending > 0) m_device.poll(true, nullptr);
+}
+
+void PipelineCache::setRecorder(PipelineManifest* manifest) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_recorder = manifest;
+}
+
+void PipelineCache::setFallback(Fallback fallback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fallback = fallback;
+}
+
+PipelineCache::Stats PipelineCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
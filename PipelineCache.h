@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+class PipelineManifest;
+
+// Render and compute pipelines by descriptor, compiled in the background so that first uses
+// do not stall the frame.
+//
+// Descriptors are keyed by a structural hash of everything that defines the pipeline: shader
+// modules and entry points, constants, vertex layouts, primitive, depth-stencil, multisample
+// and color target states (see PipelineWriter). Misses start a createRenderPipelineAsync or
+// createComputePipelineAsync and, until it completes, get() returns the fallback: nothing,
+// meaning the draw is skipped, or a stand-in pipeline compatible with the pass.
+// Compilations complete while the device is polled, which the frame loop's fence does.
+// The cache keeps references to the shader modules and layouts of its keys, so that a new
+// object reusing an address can never hit a stale entry. Every call is thread-safe.
+class PipelineCache {
+public:
+    enum class Fallback { Skip, StandIn };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0; // Compilations started
+        uint64_t fallbacks = 0; // Lookups served by the fallback while compiling
+        uint32_t pending = 0;
+        uint32_t failed = 0;
+    };
+
+    PipelineCache(wgpu::Device device, Fallback fallback = Fallback::Skip);
+    ~PipelineCache();
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    // The pipeline if it is ready, otherwise the fallback: null for Skip, standIn otherwise
+    wgpu::RenderPipeline get(const wgpu::RenderPipelineDescriptor& descriptor, wgpu::RenderPipeline standIn = nullptr);
+    wgpu::ComputePipeline get(const wgpu::ComputePipelineDescriptor& descriptor);
+    // Blocks until the pipeline is compiled, null if it failed
+    wgpu::RenderPipeline wait(const wgpu::RenderPipelineDescriptor& descriptor);
+    wgpu::ComputePipeline wait(const wgpu::ComputePipelineDescriptor& descriptor);
+    // Starts compiling ahead of the first get(), e.g. while loading
+    void prepare(const wgpu::RenderPipelineDescriptor& descriptor);
+    void prepare(const wgpu::ComputePipelineDescriptor& descriptor);
+    // True once every compilation started so far has completed
+    bool ready();
+    // Blocks until every compilation started so far has completed
+    void flush();
+
+    // Pipelines from now on are recorded into the manifest on their first get() or wait()
+    void setRecorder(PipelineManifest* manifest);
+    void setFallback(Fallback fallback);
+    Stats stats() const;
+
+private:
+    struct Entry {
+        enum class State { Pending, Ready, Failed };
+        State state = State::Pending;
+        wgpu::RenderPipeline pipeline = nullptr;
+        wgpu::ComputePipeline computePipeline = nullptr;
+        std::string key; // Serialized descriptor, compared on hash matches
+        std::vector<WGPUShaderModule> modules;
+        WGPUPipelineLayout layout = nullptr;
+        uint32_t nextWithHash = UINT32_MAX;
+        bool used = false; // By get() or wait(), rather than only prepared
+    };
+
+    // Needs the lock, which it releases to start compiling a miss
+    template <typename Descriptor>
+    uint32_t lookup(std::unique_lock<std::mutex>& lock, const Descriptor& descriptor, bool& created);
+    // Records the first use of an entry
+    template <typename Descriptor>
+    void use(Entry& entry, const Descriptor& descriptor);
+    void compile(uint32_t index, const wgpu::RenderPipelineDescriptor& descriptor);
+    void compile(uint32_t index, const wgpu::ComputePipelineDescriptor& descriptor);
+    void waitFor(std::unique_lock<std::mutex>& lock, uint32_t index);
+
+    wgpu::Device m_device;
+    mutable std::mutex m_mutex;
+    Fallback m_fallback;
+    PipelineManifest* m_recorder = nullptr;
+    std::vector<Entry> m_entries;
+    std::unordered_map<uint64_t, uint32_t> m_byHash; // First entry of each hash
+    std::string m_scratch; // Serialization of the descriptor being looked up
+    Stats m_stats;
+};
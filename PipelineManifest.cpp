@@ -0,0 +1,152 @@
+#include "PipelineManifest.h"
+#include "PipelineCache.h"
+#include "PipelineSerializer.h"
+#include "ShaderCache.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+
+using namespace wgpu;
+
+static const char kMagic[4] = { 'W', 'G', 'P', 'M' };
+static const uint32_t kVersion = 1;
+
+PipelineManifest::PipelineManifest(ShaderCache& shaders, PipelineCache& pipelines, std::string path)
+    : m_shaders(shaders), m_pipelines(pipelines), m_path(std::move(path)) {}
+
+PipelineManifest::~PipelineManifest() {
+    waitReplay();
+}
+
+void PipelineManifest::replay() {
+    waitReplay();
+    m_replay = std::thread([this]() { replayMain(); });
+}
+
+void PipelineManifest::waitReplay() {
+    if (m_replay.joinable()) m_replay.join();
+}
+
+void PipelineManifest::replayMain() {
+    // An exception would end the application with this thread, e.g. from a corrupt file
+    bool ok = false;
+    try {
+        ok = readManifest();
+    } catch (const std::exception& e) {
+        std::cerr << "Could not replay pipeline manifest " << m_path << ": " << e.what() << std::endl;
+    }
+    if (!ok) std::remove(m_path.c_str()); // save() writes a new one
+}
+
+bool PipelineManifest::readManifest() {
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file) return true; // First run
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    std::string contents = stream.str();
+
+    const char* data = contents.data();
+    const char* end = data + contents.size();
+    auto read32 = [&data, end](uint32_t& value) {
+        if (end - data < 4) return false;
+        memcpy(&value, data, 4);
+        data += 4;
+        return true;
+    };
+    auto readBlob = [&data, end, &read32](const char*& blob, uint32_t& size) {
+        if (!read32(size) || (uint32_t)(end - data) < size) return false;
+        blob = data;
+        data += size;
+        return true;
+    };
+    auto fail = [this]() {
+        std::cerr << "Ignoring malformed pipeline manifest " << m_path << std::endl;
+        return false;
+    };
+
+    uint32_t version, sourceCount, pipelineCount;
+    if (contents.size() < 4 || memcmp(data, kMagic, 4) != 0) return fail();
+    data += 4;
+    if (!read32(version) || version != kVersion) return true; // Written by another version, replaced on save
+    if (!read32(sourceCount)) return fail();
+
+    // Compiling the modules is a good part of the work, and also happens here
+    std::vector<ShaderModule> modules;
+    for (uint32_t i = 0; i < sourceCount; i++) {
+        const char* blob;
+        uint32_t size;
+        if (!readBlob(blob, size)) return fail();
+        modules.push_back(m_shaders.fromSource(std::string(blob, size), "Pipeline manifest shader"));
+    }
+
+    if (!read32(pipelineCount)) return fail();
+    for (uint32_t i = 0; i < pipelineCount; i++) {
+        const char* blob;
+        uint32_t size;
+        if (!readBlob(blob, size)) return fail();
+        StoredPipeline pipeline;
+        if (!PipelineReader(blob, size, modules).read(pipeline)) continue; // E.g. a shader that no longer compiles
+        if (pipeline.compute) m_pipelines.prepare(pipeline.computeDesc); else m_pipelines.prepare(pipeline.render);
+        m_replayed++;
+    }
+    return true;
+}
+
+template <typename Descriptor>
+void PipelineManifest::recordDescriptor(const Descriptor& descriptor) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t knownModules = m_modules.size();
+    std::string bytes;
+    bool ok = PipelineWriter(bytes, &m_modules).write(descriptor);
+    for (size_t i = knownModules; ok && i < m_modules.size(); i++) {
+        m_sources.emplace_back();
+        ok = m_shaders.sourceOf(m_modules[i], m_sources.back());
+    }
+    if (!ok) {
+        // Not representable, forget the modules it added
+        m_modules.resize(knownModules);
+        m_sources.resize(knownModules);
+        return;
+    }
+    if (m_recordedSet.insert(bytes).second) m_recorded.push_back(std::move(bytes));
+}
+
+void PipelineManifest::record(const RenderPipelineDescriptor& descriptor) {
+    recordDescriptor(descriptor);
+}
+
+void PipelineManifest::record(const ComputePipelineDescriptor& descriptor) {
+    recordDescriptor(descriptor);
+}
+
+uint32_t PipelineManifest::recordedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (uint32_t)m_recorded.size();
+}
+
+bool PipelineManifest::save() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string temporary = m_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file) return false;
+        auto write32 = [&file](uint32_t value) { file.write(reinterpret_cast<const char*>(&value), 4); };
+        file.write(kMagic, 4);
+        write32(kVersion);
+        write32((uint32_t)m_sources.size());
+        for (const std::string& source : m_sources) {
+            write32((uint32_t)source.size());
+            file.write(source.data(), source.size());
+        }
+        write32((uint32_t)m_recorded.size());
+        for (const std::string& pipeline : m_recorded) {
+            write32((uint32_t)pipeline.size());
+            file.write(pipeline.data(), pipeline.size());
+        }
+        if (!file) return false;
+    }
+    std::remove(m_path.c_str());
+    return std::rename(temporary.c_str(), m_path.c_str()) == 0;
+}
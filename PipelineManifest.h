@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+class ShaderCache;
+class PipelineCache;
+
+// Records the pipelines a run uses into a compact binary file, and replays it on the next run
+// so that those pipelines compile in the background while the rest of startup goes on.
+//
+// The file holds the final WGSL sources of the shader modules, then every pipeline descriptor
+// as written by PipelineWriter with modules as indices into those sources. Only pipelines
+// whose modules come from the ShaderCache and with automatic layouts can be recorded.
+// Replay recreates the modules through the ShaderCache, which hands out the same modules when
+// the application loads those shaders later, so the replayed descriptors are the very keys
+// the application then looks up in the PipelineCache.
+//
+// Replay runs while the device thread goes on with startup, so it must not open error scopes,
+// which would also catch that thread's errors: its modules are compiled unvalidated (see
+// ShaderCache) and a shader that no longer compiles only fails its pipelines' async creation.
+class PipelineManifest {
+public:
+    PipelineManifest(ShaderCache& shaders, PipelineCache& pipelines, std::string path);
+    // Waits for the replay, does not save
+    ~PipelineManifest();
+    PipelineManifest(const PipelineManifest&) = delete;
+    PipelineManifest& operator=(const PipelineManifest&) = delete;
+
+    // Starts compiling the saved pipelines on a worker thread, returns right away
+    void replay();
+    void waitReplay();
+
+    // Called by the PipelineCache on first use, from any thread
+    void record(const wgpu::RenderPipelineDescriptor& descriptor);
+    void record(const wgpu::ComputePipelineDescriptor& descriptor);
+    bool save() const;
+
+    uint32_t replayedCount() const { return m_replayed; }
+    uint32_t recordedCount() const;
+
+private:
+    template <typename Descriptor>
+    void recordDescriptor(const Descriptor& descriptor);
+    void replayMain();
+    bool readManifest(); // Replays it, false when the file is malformed
+
+    ShaderCache& m_shaders;
+    PipelineCache& m_pipelines;
+    std::string m_path;
+
+    mutable std::mutex m_mutex;
+    std::vector<WGPUShaderModule> m_modules; // Recorded modules, kept alive by the PipelineCache
+    std::vector<std::string> m_sources; // Source of each recorded module
+    std::vector<std::string> m_recorded; // Descriptors in recording order
+    std::unordered_set<std::string> m_recordedSet;
+
+    std::thread m_replay;
+    std::atomic<uint32_t> m_replayed{ 0 };
+};
@@ -0,0 +1,224 @@
+#include "PipelineSerializer.h"
+#include <algorithm>
+
+using namespace wgpu;
+
+void PipelineWriter::string(const char* s) {
+    uint32_t length = s ? (uint32_t)strlen(s) : UINT32_MAX;
+    value(length);
+    if (s) m_out.append(s, length);
+}
+
+bool PipelineWriter::module(WGPUShaderModule module) {
+    if (!m_modules) {
+        value((uint64_t)(uintptr_t)module);
+        return true;
+    }
+    auto it = std::find(m_modules->begin(), m_modules->end(), module);
+    if (it == m_modules->end()) it = m_modules->insert(it, module);
+    value((uint64_t)(it - m_modules->begin()));
+    return module != nullptr;
+}
+
+bool PipelineWriter::layout(WGPUPipelineLayout layout) {
+    value((uint64_t)(uintptr_t)layout);
+    return !m_modules || !layout;
+}
+
+void PipelineWriter::constants(uint32_t count, const WGPUConstantEntry* entries) {
+    value(count);
+    for (uint32_t i = 0; i < count; i++) {
+        string(entries[i].key);
+        value(entries[i].value);
+    }
+}
+
+bool PipelineWriter::write(const RenderPipelineDescriptor& d) {
+    value('R');
+    bool ok = layout(d.layout);
+    const WGPUVertexState& vertex = d.vertex;
+    ok &= module(vertex.module);
+    string(vertex.entryPoint);
+    constants(vertex.constantCount, vertex.constants);
+    value(vertex.bufferCount);
+    for (uint32_t i = 0; i < vertex.bufferCount; i++) {
+        const WGPUVertexBufferLayout& buffer = vertex.buffers[i];
+        value(buffer.arrayStride);
+        value(buffer.stepMode);
+        value(buffer.attributeCount);
+        for (uint32_t j = 0; j < buffer.attributeCount; j++) {
+            value(buffer.attributes[j].format); // Field by field, the struct has padding
+            value(buffer.attributes[j].offset);
+            value(buffer.attributes[j].shaderLocation);
+        }
+    }
+
+    value(d.primitive.topology);
+    value(d.primitive.stripIndexFormat);
+    value(d.primitive.frontFace);
+    value(d.primitive.cullMode);
+
+    value(d.depthStencil != nullptr);
+    if (d.depthStencil) {
+        const WGPUDepthStencilState& ds = *d.depthStencil;
+        value(ds.format);
+        value(ds.depthWriteEnabled);
+        value(ds.depthCompare);
+        value(ds.stencilFront);
+        value(ds.stencilBack);
+        value(ds.stencilReadMask);
+        value(ds.stencilWriteMask);
+        value(ds.depthBias);
+        value(ds.depthBiasSlopeScale);
+        value(ds.depthBiasClamp);
+    }
+
+    value(d.multisample.count);
+    value(d.multisample.mask);
+    value(d.multisample.alphaToCoverageEnabled);
+
+    value(d.fragment != nullptr);
+    if (d.fragment) {
+        const WGPUFragmentState& fragment = *d.fragment;
+        ok &= module(fragment.module);
+        string(fragment.entryPoint);
+        constants(fragment.constantCount, fragment.constants);
+        value(fragment.targetCount);
+        for (uint32_t i = 0; i < fragment.targetCount; i++) {
+            const WGPUColorTargetState& target = fragment.targets[i];
+            value(target.format);
+            value(target.writeMask);
+            value(target.blend != nullptr);
+            if (target.blend) value(*target.blend);
+        }
+    }
+    return ok;
+}
+
+bool PipelineWriter::write(const ComputePipelineDescriptor& d) {
+    value('C');
+    bool ok = layout(d.layout);
+    ok &= module(d.compute.module);
+    string(d.compute.entryPoint);
+    constants(d.compute.constantCount, d.compute.constants);
+    return ok;
+}
+
+bool PipelineReader::string(std::deque<std::string>& strings, const char*& s) {
+    uint32_t length;
+    if (!value(length)) return false;
+    if (length == UINT32_MAX) {
+        s = nullptr;
+        return true;
+    }
+    if ((size_t)(m_end - m_data) < length) return false;
+    strings.emplace_back(m_data, length);
+    m_data += length;
+    s = strings.back().c_str();
+    return true;
+}
+
+bool PipelineReader::module(WGPUShaderModule& module) {
+    uint64_t index;
+    if (!value(index) || index >= m_modules.size()) return false;
+    module = m_modules[index];
+    return module != nullptr;
+}
+
+bool PipelineReader::constants(std::deque<std::string>& strings, std::vector<WGPUConstantEntry>& entries, uint32_t& count, const WGPUConstantEntry*& pointer) {
+    if (!value(count) || !fits(count, sizeof(uint32_t) + sizeof(double))) return false;
+    entries.resize(count);
+    for (WGPUConstantEntry& entry : entries) {
+        entry.nextInChain = nullptr;
+        if (!string(strings, entry.key) || !value(entry.value)) return false;
+    }
+    pointer = entries.data();
+    return true;
+}
+
+bool PipelineReader::read(StoredPipeline& p) {
+    char type;
+    uint64_t layout;
+    if (!value(type) || !value(layout) || layout != 0) return false;
+
+    if (type == 'C') {
+        p.compute = true;
+        ComputePipelineDescriptor& d = p.computeDesc;
+        d.nextInChain = nullptr;
+        d.label       = nullptr;
+        d.layout      = nullptr;
+        d.compute.nextInChain = nullptr;
+        return module(d.compute.module) && string(p.strings, d.compute.entryPoint)
+            && constants(p.strings, p.vertexConstants, d.compute.constantCount, d.compute.constants);
+    }
+    if (type != 'R') return false;
+
+    p.compute = false;
+    RenderPipelineDescriptor& d = p.render;
+    d.nextInChain = nullptr;
+    d.label       = nullptr;
+    d.layout      = nullptr;
+    WGPUVertexState& vertex = d.vertex;
+    vertex.nextInChain = nullptr;
+    if (!module(vertex.module) || !string(p.strings, vertex.entryPoint)) return false;
+    if (!constants(p.strings, p.vertexConstants, vertex.constantCount, vertex.constants)) return false;
+    if (!value(vertex.bufferCount) || !fits(vertex.bufferCount, sizeof(uint64_t) + 2 * sizeof(uint32_t))) return false;
+    p.buffers.resize(vertex.bufferCount);
+    p.attributes.resize(vertex.bufferCount);
+    for (uint32_t i = 0; i < vertex.bufferCount; i++) {
+        WGPUVertexBufferLayout& buffer = p.buffers[i];
+        if (!value(buffer.arrayStride) || !value(buffer.stepMode) || !value(buffer.attributeCount)) return false;
+        if (!fits(buffer.attributeCount, sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t))) return false;
+        p.attributes[i].resize(buffer.attributeCount);
+        for (WGPUVertexAttribute& attribute : p.attributes[i]) {
+            if (!value(attribute.format) || !value(attribute.offset) || !value(attribute.shaderLocation)) return false;
+        }
+        buffer.attributes = p.attributes[i].data();
+    }
+    vertex.buffers = p.buffers.data();
+
+    d.primitive.nextInChain = nullptr;
+    if (!value(d.primitive.topology) || !value(d.primitive.stripIndexFormat) || !value(d.primitive.frontFace) || !value(d.primitive.cullMode)) return false;
+
+    bool hasDepthStencil;
+    if (!value(hasDepthStencil)) return false;
+    d.depthStencil = nullptr;
+    if (hasDepthStencil) {
+        DepthStencilState& ds = p.depthStencil;
+        ds.nextInChain = nullptr;
+        if (!value(ds.format) || !value(ds.depthWriteEnabled) || !value(ds.depthCompare) || !value(ds.stencilFront) || !value(ds.stencilBack)
+            || !value(ds.stencilReadMask) || !value(ds.stencilWriteMask) || !value(ds.depthBias) || !value(ds.depthBiasSlopeScale)
+            || !value(ds.depthBiasClamp)) return false;
+        d.depthStencil = &ds;
+    }
+
+    d.multisample.nextInChain = nullptr;
+    if (!value(d.multisample.count) || !value(d.multisample.mask) || !value(d.multisample.alphaToCoverageEnabled)) return false;
+
+    bool hasFragment;
+    if (!value(hasFragment)) return false;
+    d.fragment = nullptr;
+    if (hasFragment) {
+        FragmentState& fragment = p.fragment;
+        fragment.nextInChain = nullptr;
+        if (!module(fragment.module) || !string(p.strings, fragment.entryPoint)) return false;
+        if (!constants(p.strings, p.fragmentConstants, fragment.constantCount, fragment.constants)) return false;
+        if (!value(fragment.targetCount) || !fits(fragment.targetCount, 2 * sizeof(uint32_t) + 1)) return false;
+        p.targets.resize(fragment.targetCount);
+        p.blends.resize(fragment.targetCount);
+        for (uint32_t i = 0; i < fragment.targetCount; i++) {
+            WGPUColorTargetState& target = p.targets[i];
+            bool hasBlend;
+            target.nextInChain = nullptr;
+            if (!value(target.format) || !value(target.writeMask) || !value(hasBlend)) return false;
+            target.blend = nullptr;
+            if (hasBlend) {
+                if (!value(p.blends[i])) return false;
+                target.blend = &p.blends[i];
+            }
+        }
+        fragment.targets = p.targets.data();
+        d.fragment = &fragment;
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <webgpu/webgpu.hpp>
+
+// Binary form of render and compute pipeline descriptors, with every pointer followed, so that
+// equal bytes mean equal pipelines. Chained structs and labels are not part of it.
+//
+// Shader modules are written as their address, which makes a key for the current process, or
+// with a module table as their index in it, which together with the modules' sources makes a
+// description that later runs can recreate with PipelineReader. Pipeline layouts have no such
+// table: only automatic layouts can be written with one.
+class PipelineWriter {
+public:
+    explicit PipelineWriter(std::string& out, std::vector<WGPUShaderModule>* modules = nullptr) : m_out(out), m_modules(modules) {}
+
+    // Returns false when the descriptor cannot be written with the module table
+    bool write(const wgpu::RenderPipelineDescriptor& descriptor);
+    bool write(const wgpu::ComputePipelineDescriptor& descriptor);
+
+private:
+    template <typename T>
+    void value(const T& v) { m_out.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+    void string(const char* s);
+    bool module(WGPUShaderModule module);
+    bool layout(WGPUPipelineLayout layout);
+    void constants(uint32_t count, const WGPUConstantEntry* entries);
+
+    std::string& m_out;
+    std::vector<WGPUShaderModule>* m_modules;
+};
+
+// A descriptor read back from PipelineWriter's output, owning everything it points to
+struct StoredPipeline {
+    StoredPipeline() = default;
+    StoredPipeline(const StoredPipeline&) = delete;
+    StoredPipeline& operator=(const StoredPipeline&) = delete;
+
+    bool compute = false;
+    wgpu::RenderPipelineDescriptor render;
+    wgpu::ComputePipelineDescriptor computeDesc;
+
+    std::deque<std::string> strings;
+    std::vector<WGPUConstantEntry> vertexConstants;
+    std::vector<WGPUConstantEntry> fragmentConstants;
+    std::vector<WGPUVertexBufferLayout> buffers;
+    std::vector<std::vector<WGPUVertexAttribute>> attributes;
+    wgpu::DepthStencilState depthStencil;
+    wgpu::FragmentState fragment;
+    std::vector<WGPUColorTargetState> targets;
+    std::vector<WGPUBlendState> blends;
+};
+
+// Reads descriptors written with a module table, modules[i] standing for index i
+class PipelineReader {
+public:
+    PipelineReader(const char* data, size_t size, const std::vector<wgpu::ShaderModule>& modules)
+        : m_data(data), m_end(data + size), m_modules(modules) {}
+
+    // False on malformed data or unknown modules
+    bool read(StoredPipeline& pipeline);
+
+private:
+    template <typename T>
+    bool value(T& v) {
+        if ((size_t)(m_end - m_data) < sizeof(T)) return false;
+        memcpy(&v, m_data, sizeof(T));
+        m_data += sizeof(T);
+        return true;
+    }
+    // Written as one byte, other values than 0 and 1 would be undefined behaviour as a bool
+    bool value(bool& v) {
+        uint8_t byte;
+        if (!value(byte) || byte > 1) return false;
+        v = byte != 0;
+        return true;
+    }
+    // Whether count items of at least size bytes each can follow, checked before any resize()
+    bool fits(uint64_t count, size_t size) const { return count <= (uint64_t)(m_end - m_data) / size; }
+    bool string(std::deque<std::string>& strings, const char*& s);
+    bool module(WGPUShaderModule& module);
+    bool constants(std::deque<std::string>& strings, std::vector<WGPUConstantEntry>& entries, uint32_t& count, const WGPUConstantEntry*& pointer);
+
+    const char* m_data;
+    const char* m_end;
+    const std::vector<wgpu::ShaderModule>& m_modules;
+};
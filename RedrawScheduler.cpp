@@ -0,0 +1,22 @@
+#include "RedrawScheduler.h"
+#include <algorithm>
+
+RedrawScheduler::RedrawScheduler(RedrawMode mode) : m_mode(mode) {}
+
+void RedrawScheduler::invalidateAt(double time) {
+    m_deadline = m_deadline < 0.0 ? time : std::min(m_deadline, time);
+}
+
+double RedrawScheduler::timeUntilFrame(double now) {
+    if (continuous() || m_dirty) return 0.0;
+    if (m_deadline >= 0.0) {
+        double remaining = m_deadline - now;
+        if (remaining <= 0.0) {
+            m_deadline = -1.0;
+            m_dirty = true;
+            return 0.0;
+        }
+        return std::min(idleTimeout, remaining);
+    }
+    return idleTimeout;
+}
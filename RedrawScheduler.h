@@ -0,0 +1,38 @@
+#pragma once
+
+enum class RedrawMode {
+    Continuous, // Render every frame
+    OnDemand,   // Render only when the frame is dirty or an animation runs
+};
+
+// Decides when the next frame is rendered. In OnDemand mode the render loop blocks until
+// input, a resize, an explicit invalidation or a scheduled deadline marks the frame dirty,
+// so a static frame costs no CPU/GPU time. While any animation runs it falls back to
+// continuous rendering. Not thread-safe, owned by the thread that renders.
+class RedrawScheduler {
+public:
+    explicit RedrawScheduler(RedrawMode mode = RedrawMode::Continuous);
+
+    void invalidate() { m_dirty = true; }
+    // Redraw once the clock reaches time (seconds), e.g. the next refresh of a dashboard panel
+    void invalidateAt(double time);
+
+    void beginAnimation() { m_animations++; }
+    void endAnimation() { if (m_animations > 0) m_animations--; }
+    bool continuous() const { return m_mode == RedrawMode::Continuous || m_animations > 0; }
+
+    // How long the caller may block before a frame is due, 0 if one is due now.
+    // Never more than idleTimeout.
+    double timeUntilFrame(double now);
+    // Clears the dirty flag, call after rendering
+    void frameRendered() { m_dirty = false; }
+
+    RedrawMode mode() const { return m_mode; }
+    double idleTimeout = 0.5; // Seconds
+
+private:
+    RedrawMode m_mode;
+    bool m_dirty = true;
+    int m_animations = 0;
+    double m_deadline = -1.0;
+};
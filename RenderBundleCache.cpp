@@ -0,0 +1,119 @@
+#include "RenderBundleCache.h"
+#include "RenderPassRecorder.h"
+#include <algorithm>
+#include <tuple>
+#include <cassert>
+
+using namespace wgpu;
+
+RenderBundleCache::RenderBundleCache(Fence& fence, TextureFormat colorFormat, TextureFormat depthStencilFormat, uint32_t sampleCount)
+    : m_fence(fence), m_device(fence.getDevice()), m_colorFormat(colorFormat) {
+    m_encoderDesc = RenderBundleEncoderDescriptor();
+    m_encoderDesc.nextInChain        = nullptr;
+    m_encoderDesc.label              = "Static draws";
+    m_encoderDesc.colorFormatsCount  = 1;
+    m_encoderDesc.colorFormats       = &m_colorFormat;
+    m_encoderDesc.depthStencilFormat = depthStencilFormat;
+    m_encoderDesc.sampleCount        = sampleCount;
+    m_encoderDesc.depthReadOnly      = false;
+    m_encoderDesc.stencilReadOnly    = false;
+}
+
+RenderBundleCache::~RenderBundleCache() {
+    clear();
+}
+
+uint32_t RenderBundleCache::add(uint32_t group, const DrawQueue::Draw& draw) {
+    uint32_t id;
+    if (!m_freeSlots.empty()) {
+        id = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        id = (uint32_t)m_slots.size();
+        m_slots.emplace_back();
+    }
+    if (group >= m_groups.size()) m_groups.resize(group + 1);
+    Group& g = m_groups[group];
+    Slot& slot = m_slots[id];
+    slot.draw     = draw;
+    slot.group    = group;
+    slot.position = (uint32_t)g.draws.size();
+    g.draws.push_back(id);
+    g.dirty = true;
+    m_stats.draws++;
+    return id;
+}
+
+void RenderBundleCache::update(uint32_t id, const DrawQueue::Draw& draw) {
+    Slot& slot = m_slots[id];
+    assert(slot.group != UINT32_MAX);
+    if (slot.group == UINT32_MAX) return; // Removed
+    slot.draw = draw;
+    m_groups[slot.group].dirty = true;
+}
+
+void RenderBundleCache::remove(uint32_t id) {
+    Slot& slot = m_slots[id];
+    assert(slot.group != UINT32_MAX);
+    if (slot.group == UINT32_MAX) return; // Already removed
+    Group& group = m_groups[slot.group];
+    uint32_t last = group.draws.back();
+    group.draws[slot.position] = last;
+    m_slots[last].position = slot.position;
+    group.draws.pop_back();
+    group.dirty = true;
+    slot = Slot();
+    m_freeSlots.push_back(id);
+    m_stats.draws--;
+}
+
+void RenderBundleCache::clear() {
+    for (Group& group : m_groups) releaseBundle(group);
+    m_groups.clear();
+    m_slots.clear();
+    m_freeSlots.clear();
+    m_stats.draws = 0;
+}
+
+void RenderBundleCache::releaseBundle(Group& group) {
+    if (!group.bundle) return;
+    m_fence.releaseAfter(m_fence.lastSignaled() + 1, group.bundle); // The current frame may have executed it already
+    group.bundle = nullptr;
+    m_stats.bundles--;
+}
+
+void RenderBundleCache::record(Group& group) {
+    releaseBundle(group);
+    group.dirty = false;
+    if (group.draws.empty()) return;
+
+    // Recorded rarely, so a comparison sort by state is fine here
+    auto state = [this](uint32_t id) {
+        const DrawQueue::Draw& draw = m_slots[id].draw;
+        return std::make_tuple(static_cast<WGPURenderPipeline>(draw.pipeline), static_cast<WGPUBindGroup>(draw.bindGroup),
+                               static_cast<WGPUBuffer>(draw.vertexBuffer), static_cast<WGPUBuffer>(draw.indexBuffer), draw.indexFormat);
+    };
+    std::sort(group.draws.begin(), group.draws.end(), [&state](uint32_t a, uint32_t b) { return state(a) < state(b); });
+    for (uint32_t i = 0; i < (uint32_t)group.draws.size(); i++) m_slots[group.draws[i]].position = i;
+
+    m_pointers.clear();
+    for (uint32_t id : group.draws) m_pointers.push_back(&m_slots[id].draw);
+    RenderBundleEncoder encoder = m_device.createRenderBundleEncoder(m_encoderDesc);
+    encodeDraws(encoder, m_pointers.data(), (uint32_t)m_pointers.size());
+    RenderBundleDescriptor bundleDesc;
+    bundleDesc.nextInChain = nullptr;
+    bundleDesc.label       = "Static draws";
+    group.bundle = encoder.finish(bundleDesc);
+    encoder.release();
+    m_stats.bundles++;
+    m_stats.recorded++;
+}
+
+void RenderBundleCache::execute(RenderPassRecorder& renderPass) {
+    m_executed.clear();
+    for (Group& group : m_groups) {
+        if (group.dirty) record(group);
+        if (group.bundle) m_executed.push_back(group.bundle);
+    }
+    if (!m_executed.empty()) renderPass.executeBundles((uint32_t)m_executed.size(), m_executed.data());
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+#include "DrawQueue.h"
+
+class RenderPassRecorder;
+
+// Records draws that do not change from frame to frame into render bundles once, and replays
+// them with a single executeBundles per frame.
+//
+// Draws are added to groups, e.g. one per object type or region of the scene, and each group
+// becomes one bundle. Adding, updating or removing a draw only marks its group dirty: the
+// bundle is re-recorded at the next execute(), with its draws sorted by state, and the other
+// groups are replayed as recorded. The encoding cost of a static scene then depends on the
+// number of groups, not of draws. Bundles must match the pass they execute in, so the cache is
+// created for the pass's attachment formats. Objects the draws reference must outlive them.
+class RenderBundleCache {
+public:
+    struct Stats {
+        uint32_t draws = 0;
+        uint32_t bundles = 0;
+        uint64_t recorded = 0; // Bundle recordings since the cache was created
+    };
+
+    RenderBundleCache(wgpu::Fence& fence, wgpu::TextureFormat colorFormat,
+                      wgpu::TextureFormat depthStencilFormat = wgpu::TextureFormat::Undefined, uint32_t sampleCount = 1);
+    ~RenderBundleCache();
+    RenderBundleCache(const RenderBundleCache&) = delete;
+    RenderBundleCache& operator=(const RenderBundleCache&) = delete;
+
+    // Returns an id for update() and remove(), which ignore ids already removed
+    uint32_t add(uint32_t group, const DrawQueue::Draw& draw);
+    void update(uint32_t id, const DrawQueue::Draw& draw);
+    void remove(uint32_t id);
+    void clear();
+
+    // Re-records the dirty groups, then executes every bundle
+    void execute(RenderPassRecorder& renderPass);
+
+    Stats stats() const { return m_stats; }
+
+private:
+    struct Slot {
+        DrawQueue::Draw draw;
+        uint32_t group = UINT32_MAX; // UINT32_MAX when the slot is free
+        uint32_t position = 0;       // In the group's draws
+    };
+    struct Group {
+        std::vector<uint32_t> draws;
+        wgpu::RenderBundle bundle = nullptr;
+        bool dirty = false;
+    };
+
+    void record(Group& group);
+    void releaseBundle(Group& group);
+
+    wgpu::Fence& m_fence;
+    wgpu::Device m_device;
+    WGPUTextureFormat m_colorFormat;
+    wgpu::RenderBundleEncoderDescriptor m_encoderDesc;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<Group> m_groups;
+    std::vector<wgpu::RenderBundle> m_executed;
+    std::vector<const DrawQueue::Draw*> m_pointers; // Of the group being recorded
+    Stats m_stats;
+};
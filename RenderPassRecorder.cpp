@@ -0,0 +1,148 @@
+#include "RenderPassRecorder.h"
+#include <algorithm>
+
+using namespace wgpu;
+
+uint64_t RenderPassRecorder::Stats::filtered() const {
+    return pipelinesFiltered + bindGroupsFiltered + vertexBuffersFiltered + indexBuffersFiltered + viewportsFiltered + scissorsFiltered;
+}
+
+RenderPassRecorder::Stats& RenderPassRecorder::Stats::operator+=(const Stats& other) {
+    draws += other.draws;
+    forwarded += other.forwarded;
+    pipelinesFiltered += other.pipelinesFiltered;
+    bindGroupsFiltered += other.bindGroupsFiltered;
+    vertexBuffersFiltered += other.vertexBuffersFiltered;
+    indexBuffersFiltered += other.indexBuffersFiltered;
+    viewportsFiltered += other.viewportsFiltered;
+    scissorsFiltered += other.scissorsFiltered;
+    return *this;
+}
+
+RenderPassRecorder::RenderPassRecorder(RenderPassEncoder encoder) : m_encoder(encoder) {}
+
+void RenderPassRecorder::setPipeline(RenderPipeline pipeline) {
+    if (m_pipeline == static_cast<WGPURenderPipeline>(pipeline)) {
+        m_stats.pipelinesFiltered++;
+        return;
+    }
+    m_pipeline = pipeline;
+    m_encoder.setPipeline(pipeline);
+    m_stats.forwarded++;
+}
+
+void RenderPassRecorder::setBindGroup(uint32_t groupIndex, BindGroup group, uint32_t dynamicOffsetCount, const uint32_t* dynamicOffsets) {
+    if (groupIndex >= MaxBindGroups) {
+        m_encoder.setBindGroup(groupIndex, group, dynamicOffsetCount, dynamicOffsets); // Let validation report it
+        return;
+    }
+    BindGroupState& state = m_bindGroups[groupIndex];
+    if (state.group == static_cast<WGPUBindGroup>(group) && state.dynamicOffsets.size() == dynamicOffsetCount
+        && std::equal(state.dynamicOffsets.begin(), state.dynamicOffsets.end(), dynamicOffsets)) {
+        m_stats.bindGroupsFiltered++;
+        return;
+    }
+    state.group = group;
+    state.dynamicOffsets.assign(dynamicOffsets, dynamicOffsets + dynamicOffsetCount);
+    m_encoder.setBindGroup(groupIndex, group, dynamicOffsetCount, dynamicOffsets);
+    m_stats.forwarded++;
+}
+
+void RenderPassRecorder::setVertexBuffer(uint32_t slot, Buffer buffer, uint64_t offset, uint64_t size) {
+    if (slot >= MaxVertexBuffers) {
+        m_encoder.setVertexBuffer(slot, buffer, offset, size);
+        return;
+    }
+    BufferState& state = m_vertexBuffers[slot];
+    if (state.buffer == static_cast<WGPUBuffer>(buffer) && state.offset == offset && state.size == size) {
+        m_stats.vertexBuffersFiltered++;
+        return;
+    }
+    state = { buffer, offset, size };
+    m_encoder.setVertexBuffer(slot, buffer, offset, size);
+    m_stats.forwarded++;
+}
+
+void RenderPassRecorder::setIndexBuffer(Buffer buffer, IndexFormat format, uint64_t offset, uint64_t size) {
+    BufferState& state = m_indexBuffer;
+    if (state.buffer == static_cast<WGPUBuffer>(buffer) && m_indexFormat == format && state.offset == offset && state.size == size) {
+        m_stats.indexBuffersFiltered++;
+        return;
+    }
+    state = { buffer, offset, size };
+    m_indexFormat = format;
+    m_encoder.setIndexBuffer(buffer, format, offset, size);
+    m_stats.forwarded++;
+}
+
+void RenderPassRecorder::setViewport(float x, float y, float width, float height, float minDepth, float maxDepth) {
+    const float viewport[6] = { x, y, width, height, minDepth, maxDepth };
+    if (m_viewportSet && std::equal(viewport, viewport + 6, m_viewport)) {
+        m_stats.viewportsFiltered++;
+        return;
+    }
+    std::copy(viewport, viewport + 6, m_viewport);
+    m_viewportSet = true;
+    m_encoder.setViewport(x, y, width, height, minDepth, maxDepth);
+    m_stats.forwarded++;
+}
+
+void RenderPassRecorder::setScissorRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    const uint32_t scissor[4] = { x, y, width, height };
+    if (m_scissorSet && std::equal(scissor, scissor + 4, m_scissor)) {
+        m_stats.scissorsFiltered++;
+        return;
+    }
+    std::copy(scissor, scissor + 4, m_scissor);
+    m_scissorSet = true;
+    m_encoder.setScissorRect(x, y, width, height);
+    m_stats.forwarded++;
+}
+
+void RenderPassRecorder::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+    m_encoder.draw(vertexCount, instanceCount, firstVertex, firstInstance);
+    m_stats.draws++;
+}
+
+void RenderPassRecorder::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) {
+    m_encoder.drawIndexed(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+    m_stats.draws++;
+}
+
+void RenderPassRecorder::drawIndirect(Buffer indirectBuffer, uint64_t indirectOffset) {
+    m_encoder.drawIndirect(indirectBuffer, indirectOffset);
+    m_stats.draws++;
+}
+
+void RenderPassRecorder::drawIndexedIndirect(Buffer indirectBuffer, uint64_t indirectOffset) {
+    m_encoder.drawIndexedIndirect(indirectBuffer, indirectOffset);
+    m_stats.draws++;
+}
+
+void RenderPassRecorder::multiDrawIndexedIndirect(Buffer indirectBuffer, uint64_t indirectOffset, uint32_t count) {
+    wgpuRenderPassEncoderMultiDrawIndexedIndirect(m_encoder, indirectBuffer, indirectOffset, count);
+    m_stats.draws++;
+}
+
+void RenderPassRecorder::multiDrawIndexedIndirectCount(Buffer indirectBuffer, uint64_t indirectOffset, Buffer countBuffer, uint64_t countOffset, uint32_t maxCount) {
+    wgpuRenderPassEncoderMultiDrawIndexedIndirectCount(m_encoder, indirectBuffer, indirectOffset, countBuffer, countOffset, maxCount);
+    m_stats.draws++;
+}
+
+void RenderPassRecorder::executeBundles(uint32_t bundleCount, const RenderBundle* bundles) {
+    m_encoder.executeBundles(bundleCount, bundles);
+    invalidate();
+}
+
+void RenderPassRecorder::invalidate() {
+    m_pipeline = nullptr;
+    for (BindGroupState& state : m_bindGroups) {
+        state.group = nullptr;
+        state.dynamicOffsets.clear();
+    }
+    for (BufferState& state : m_vertexBuffers) state = BufferState();
+    m_indexBuffer = BufferState();
+    m_indexFormat = WGPUIndexFormat_Undefined;
+    m_viewportSet = false;
+    m_scissorSet = false;
+}
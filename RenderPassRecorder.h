@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+// Forwards draw state to a RenderPassEncoder, minus the calls that would not change it.
+//
+// Tracks the pipeline, bind groups (with their dynamic offsets), vertex and index buffers,
+// viewport and scissor rect of the pass and drops the set calls that repeat the current
+// value. Each call that reaches wgpu-native is validated and recorded, which adds up in scenes
+// with thousands of draws. Objects set on the pass are kept alive by it, so comparing handles
+// is safe for the recorder's lifetime: one recorder per pass.
+// State set directly on encoder() is not tracked, use the recorder for every state change.
+class RenderPassRecorder {
+public:
+    static constexpr uint32_t MaxBindGroups = 8;
+    static constexpr uint32_t MaxVertexBuffers = 16;
+
+    struct Stats {
+        uint64_t draws = 0;
+        uint64_t forwarded = 0; // State changes that reached the encoder
+        uint64_t pipelinesFiltered = 0;
+        uint64_t bindGroupsFiltered = 0;
+        uint64_t vertexBuffersFiltered = 0;
+        uint64_t indexBuffersFiltered = 0;
+        uint64_t viewportsFiltered = 0;
+        uint64_t scissorsFiltered = 0;
+
+        uint64_t filtered() const;
+        Stats& operator+=(const Stats& other);
+    };
+
+    explicit RenderPassRecorder(wgpu::RenderPassEncoder encoder);
+
+    void setPipeline(wgpu::RenderPipeline pipeline);
+    void setBindGroup(uint32_t groupIndex, wgpu::BindGroup group, uint32_t dynamicOffsetCount = 0, const uint32_t* dynamicOffsets = nullptr);
+    void setVertexBuffer(uint32_t slot, wgpu::Buffer buffer, uint64_t offset = 0, uint64_t size = WGPU_WHOLE_SIZE);
+    void setIndexBuffer(wgpu::Buffer buffer, wgpu::IndexFormat format, uint64_t offset = 0, uint64_t size = WGPU_WHOLE_SIZE);
+    void setViewport(float x, float y, float width, float height, float minDepth, float maxDepth);
+    void setScissorRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+    void draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0);
+    void drawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t baseVertex = 0, uint32_t firstInstance = 0);
+    void drawIndirect(wgpu::Buffer indirectBuffer, uint64_t indirectOffset);
+    void drawIndexedIndirect(wgpu::Buffer indirectBuffer, uint64_t indirectOffset);
+    // wgpu-native extensions, need NativeFeature::MultiDrawIndirect and MultiDrawIndirectCount.
+    // Each counts as one draw, however many the GPU runs.
+    void multiDrawIndexedIndirect(wgpu::Buffer indirectBuffer, uint64_t indirectOffset, uint32_t count);
+    void multiDrawIndexedIndirectCount(wgpu::Buffer indirectBuffer, uint64_t indirectOffset, wgpu::Buffer countBuffer, uint64_t countOffset, uint32_t maxCount);
+    // Bundles reset the pass state, the next set calls are always forwarded
+    void executeBundles(uint32_t bundleCount, const wgpu::RenderBundle* bundles);
+
+    // Forgets the tracked state, e.g. after setting state on the encoder directly
+    void invalidate();
+
+    wgpu::RenderPassEncoder encoder() { return m_encoder; }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct BindGroupState {
+        WGPUBindGroup group = nullptr;
+        std::vector<uint32_t> dynamicOffsets;
+    };
+    struct BufferState {
+        WGPUBuffer buffer = nullptr;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    wgpu::RenderPassEncoder m_encoder;
+    WGPURenderPipeline m_pipeline = nullptr;
+    BindGroupState m_bindGroups[MaxBindGroups];
+    BufferState m_vertexBuffers[MaxVertexBuffers];
+    BufferState m_indexBuffer;
+    WGPUIndexFormat m_indexFormat = WGPUIndexFormat_Undefined;
+    float m_viewport[6] = {};
+    bool m_viewportSet = false; // The pass starts with a viewport covering its attachments, which is unknown here
+    uint32_t m_scissor[4] = {};
+    bool m_scissorSet = false;
+    Stats m_stats;
+};
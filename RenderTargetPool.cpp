@@ -0,0 +1,142 @@
+#include "RenderTargetPool.h"
+#include "BindGroupCache.h"
+#include <cassert>
+
+using namespace wgpu;
+
+static uint64_t texelSize(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::R8Unorm: return 1;
+    case TextureFormat::RG8Unorm:
+    case TextureFormat::R16Float:
+    case TextureFormat::Depth16Unorm: return 2;
+    case TextureFormat::RGBA8Unorm:
+    case TextureFormat::RGBA8UnormSrgb:
+    case TextureFormat::BGRA8Unorm:
+    case TextureFormat::BGRA8UnormSrgb:
+    case TextureFormat::RGB10A2Unorm:
+    case TextureFormat::RG11B10Ufloat:
+    case TextureFormat::RG16Float:
+    case TextureFormat::R32Float:
+    case TextureFormat::Depth24Plus:
+    case TextureFormat::Depth24PlusStencil8:
+    case TextureFormat::Depth32Float: return 4;
+    case TextureFormat::RGBA16Float:
+    case TextureFormat::RG32Float: return 8;
+    case TextureFormat::RGBA32Float: return 16;
+    default: return 0;
+    }
+}
+
+RenderTargetPool::RenderTargetPool(Fence& fence, uint32_t maxIdleFrames)
+    : m_fence(fence), m_device(fence.getDevice()), m_maxIdleFrames(maxIdleFrames) {}
+
+RenderTargetPool::~RenderTargetPool() {
+    m_fence.waitIdle();
+    for (Entry& entry : m_entries) destroy(entry);
+}
+
+void RenderTargetPool::destroy(Entry& entry) {
+    if (!entry.texture) return;
+    if (m_bindGroups) m_bindGroups->invalidate(entry.view);
+    m_stats.textures--;
+    m_stats.bytes -= texelSize(entry.desc.format) * entry.desc.width * entry.desc.height * entry.desc.sampleCount;
+    entry.view.release();
+    entry.texture.destroy();
+    entry.texture.release();
+    entry.texture = nullptr;
+    entry.view = nullptr;
+}
+
+void RenderTargetPool::beginFrame() {
+    m_frame++;
+    m_completed = m_fence.completedValue();
+    for (uint32_t i = 0; i < (uint32_t)m_entries.size(); i++) {
+        Entry& entry = m_entries[i];
+        if (!entry.texture || entry.inUse || m_frame - entry.lastFrame <= m_maxIdleFrames) continue;
+        if (entry.lastSubmission > m_completed) continue;
+        destroy(entry);
+        m_unusedEntries.push_back(i);
+    }
+}
+
+RenderTarget RenderTargetPool::acquire(const RenderTargetDesc& desc, const char* label) {
+    // Prefer a texture this frame already used, sharing its memory, over a retired one
+    uint32_t found = UINT32_MAX;
+    for (uint32_t i = 0; i < (uint32_t)m_entries.size(); i++) {
+        const Entry& entry = m_entries[i];
+        if (!entry.texture || entry.inUse || !(entry.desc == desc)) continue;
+        if (entry.lastFrame == m_frame) {
+            found = i;
+            m_stats.aliased++;
+            break;
+        }
+        if (entry.lastSubmission <= m_completed && found == UINT32_MAX) found = i;
+    }
+
+    if (found == UINT32_MAX) {
+        TextureDescriptor textureDesc;
+        textureDesc.label           = label;
+        textureDesc.dimension       = TextureDimension::_2D;
+        textureDesc.size            = { desc.width, desc.height, 1 };
+        textureDesc.format          = desc.format;
+        textureDesc.usage           = desc.usage;
+        textureDesc.mipLevelCount   = 1;
+        textureDesc.sampleCount     = desc.sampleCount;
+        textureDesc.viewFormatCount = 0;
+        textureDesc.viewFormats     = nullptr;
+
+        Entry entry;
+        entry.desc    = desc;
+        entry.texture = m_device.createTexture(textureDesc);
+
+        TextureViewDescriptor viewDesc;
+        viewDesc.label           = label;
+        viewDesc.format          = desc.format;
+        viewDesc.dimension       = TextureViewDimension::_2D;
+        viewDesc.baseMipLevel    = 0;
+        viewDesc.mipLevelCount   = 1;
+        viewDesc.baseArrayLayer  = 0;
+        viewDesc.arrayLayerCount = 1;
+        viewDesc.aspect          = TextureAspect::All;
+        entry.view = entry.texture.createView(viewDesc);
+
+        m_stats.textures++;
+        m_stats.created++;
+        m_stats.bytes += texelSize(desc.format) * desc.width * desc.height * desc.sampleCount;
+        if (!m_unusedEntries.empty()) {
+            found = m_unusedEntries.back();
+            m_unusedEntries.pop_back();
+            m_entries[found] = entry;
+        } else {
+            found = (uint32_t)m_entries.size();
+            m_entries.push_back(entry);
+        }
+    }
+
+    Entry& entry = m_entries[found];
+    entry.inUse     = true;
+    entry.lastFrame = m_frame;
+    RenderTarget target;
+    target.texture = entry.texture;
+    target.view    = entry.view;
+    target.index   = found;
+    return target;
+}
+
+void RenderTargetPool::release(RenderTarget& target) {
+    if (!target) return;
+    Entry& entry = m_entries[target.index];
+    assert(entry.inUse);
+    entry.inUse = false;
+    entry.lastSubmission = m_fence.lastSignaled() + 1; // The submission of the frame being recorded
+    target = RenderTarget();
+}
+
+void RenderTargetPool::endFrame() {
+    for (Entry& entry : m_entries) {
+        if (!entry.inUse) continue;
+        entry.inUse = false;
+        entry.lastSubmission = m_fence.lastSignaled() + 1;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+class BindGroupCache;
+
+struct RenderTargetDesc {
+    wgpu::TextureFormat format = wgpu::TextureFormat::RGBA8Unorm;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    WGPUTextureUsageFlags usage = wgpu::TextureUsage::RenderAttachment | wgpu::TextureUsage::TextureBinding;
+    uint32_t sampleCount = 1;
+
+    bool operator==(const RenderTargetDesc& other) const {
+        return format == other.format && width == other.width && height == other.height && usage == other.usage
+            && sampleCount == other.sampleCount;
+    }
+};
+
+struct RenderTarget {
+    wgpu::Texture texture = nullptr;
+    wgpu::TextureView view = nullptr; // Whole texture, owned by the pool
+    uint32_t index = UINT32_MAX;
+
+    explicit operator bool() const { return index != UINT32_MAX; }
+};
+
+// Hands out transient render targets and depth buffers, e.g. for post-processing chains, so
+// that frames stop creating and destroying textures.
+//
+// Targets are keyed by (format, size, usage, sample count). A target released during a frame
+// goes back to the pool right away and the next acquire() of the same key in that frame gets
+// the same texture: targets whose lifetimes do not overlap share memory, in submission order.
+// Targets still held at endFrame() are released then. Textures used by a frame only go to
+// later frames once its submission retired, and textures unused for a number of frames are
+// destroyed, e.g. after a resize.
+class RenderTargetPool {
+public:
+    struct Stats {
+        uint32_t textures = 0;
+        uint32_t created = 0; // Since the pool was created
+        uint32_t aliased = 0; // Acquires served by a texture already used earlier in the same frame
+        uint64_t bytes = 0; // Estimated, for formats with a known texel size
+    };
+
+    RenderTargetPool(wgpu::Fence& fence, uint32_t maxIdleFrames = 8);
+    ~RenderTargetPool();
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    void beginFrame();
+    RenderTarget acquire(const RenderTargetDesc& desc, const char* label = "Render target");
+    // Call after the last command using the target was recorded, frees it for aliasing
+    void release(RenderTarget& target);
+    // Call before submitting the frame with the fence
+    void endFrame();
+
+    // Groups of the cache that reference a target's view are dropped when its texture is
+    // destroyed. The cache must outlive the pool.
+    void setBindGroupCache(BindGroupCache* cache) { m_bindGroups = cache; }
+
+    Stats stats() const { return m_stats; }
+
+private:
+    struct Entry {
+        RenderTargetDesc desc;
+        wgpu::Texture texture = nullptr;
+        wgpu::TextureView view = nullptr;
+        wgpu::SubmissionIndex lastSubmission = 0;
+        uint64_t lastFrame = 0;
+        bool inUse = false;
+    };
+
+    void destroy(Entry& entry);
+
+    wgpu::Fence& m_fence;
+    wgpu::Device m_device;
+    uint32_t m_maxIdleFrames;
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_unusedEntries;
+    uint64_t m_frame = 1;
+    wgpu::SubmissionIndex m_completed = 0;
+    Stats m_stats;
+    BindGroupCache* m_bindGroups = nullptr;
+};
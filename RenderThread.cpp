@@ -0,0 +1,149 @@
+#include "RenderThread.h"
+#include "FrameProfiler.h"
+#include "Clock.h"
+#include <future>
+#include <chrono>
+#include <iostream>
+#include <GLFW/glfw3.h>
+
+using namespace wgpu;
+
+RenderThread::RenderThread(const RenderSettings& settings, JobSystem* jobs) : m_settings(settings), m_jobs(jobs) {}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+bool RenderThread::start(Instance instance, Surface surface, const AppState& initialState) {
+    std::promise<bool> initialized;
+    std::future<bool> result = initialized.get_future();
+    m_state.write(initialState);
+    m_quit = false;
+    m_thread = std::thread([this, instance, surface, initialState, initialized = std::move(initialized)]() mutable {
+        RendererConfig config;
+        config.width  = initialState.width;
+        config.height = initialState.height;
+        config.pacing = m_settings.pacing.policy;
+        config.forceFallbackAdapter = m_settings.forceFallbackAdapter;
+        config.jobs   = m_jobs;
+        Renderer renderer;
+        bool ok = renderer.initialize(instance, surface, config);
+        initialized.set_value(ok);
+        if (!ok) return;
+        run(renderer, initialState);
+    });
+    if (!result.get()) {
+        m_thread.join();
+        return false;
+    }
+    return true;
+}
+
+void RenderThread::stop() {
+    if (!m_thread.joinable()) return;
+    m_quit = true;
+    wake();
+    m_thread.join();
+    if (m_droppedMessages > 0) std::cerr << "Render thread dropped " << m_droppedMessages << " input messages" << std::endl;
+}
+
+void RenderThread::post(const InputMessage& message) {
+    if (!m_messages.push(message)) m_droppedMessages++; // Queue full, state snapshots still carry the latest input
+    wake();
+}
+
+void RenderThread::publish(const AppState& state) {
+    m_state.write(state);
+    wake();
+}
+
+void RenderThread::wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakePending = true;
+    }
+    m_wakeCondition.notify_one();
+}
+
+void RenderThread::sleep(double seconds) {
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wakeCondition.wait_for(lock, std::chrono::duration<double>(seconds), [this]() { return m_wakePending; });
+    m_wakePending = false;
+}
+
+void RenderThread::run(Renderer& renderer, AppState state) {
+    RedrawScheduler redraw(m_settings.redraw);
+    FrameLimiter limiter(m_settings.pacing.policy == PacingPolicy::TargetFps ? m_settings.pacing.targetFps : 0.0);
+    FrameTimeStats frameTimes;
+    const double timerFrequency = (double)Clock::frequency();
+    uint64_t lastFrameStart = 0;
+    uint64_t lastReport = Clock::ticks();
+
+    bool pulsing = false;
+    FrameState frame;
+    double lastTime = Clock::seconds();
+
+    while (!m_quit) {
+        InputMessage message;
+        while (m_messages.pop(message)) {
+            handle(renderer, message);
+            redraw.invalidate(); // Any input may change the frame
+        }
+
+        if (m_state.read(state)) redraw.invalidate();
+        if (state.pulsing != pulsing) {
+            pulsing = state.pulsing;
+            if (pulsing) redraw.beginAnimation(); else redraw.endAnimation();
+        }
+        if (state.width != renderer.width() || state.height != renderer.height()) {
+            renderer.resize(state.width, state.height);
+        }
+
+        double idle = redraw.timeUntilFrame(Clock::seconds());
+        if (idle > 0.0) {
+            sleep(idle);
+            lastFrameStart = 0; // Idle gaps are not frame times
+            continue;
+        }
+        if (redraw.continuous()) limiter.wait();
+
+        double time = Clock::seconds();
+        if (pulsing) frame.pulseTime += time - lastTime;
+        lastTime = time;
+
+        uint64_t frameStart = Clock::ticks();
+        if (lastFrameStart != 0) frameTimes.addSample((double)(frameStart - lastFrameStart) / timerFrequency);
+        lastFrameStart = redraw.continuous() ? frameStart : 0;
+        if ((double)(frameStart - lastReport) / timerFrequency >= 0.5 && frameTimes.count() > 1) {
+            FrameReport report;
+            report.frames   = frameTimes.count();
+            report.mean     = frameTimes.mean();
+            report.variance = frameTimes.variance();
+            report.max      = frameTimes.max();
+            m_report.write(report);
+            glfwPostEmptyEvent(); // Wakes up the main thread to show it
+            frameTimes.reset();
+            lastReport = frameStart;
+        }
+
+        renderer.renderFrame(frame);
+        redraw.frameRendered();
+    }
+
+    FrameProfiler& profiler = *renderer.profiler();
+    profiler.printSummary(std::cout);
+    if (!m_settings.tracePath.empty()) {
+        if (profiler.exportChromeTrace(m_settings.tracePath.c_str())) {
+            std::cout << "Wrote frame trace to " << m_settings.tracePath << std::endl;
+        } else {
+            std::cerr << "Could not write frame trace to " << m_settings.tracePath << std::endl;
+        }
+    }
+    renderer.terminate();
+}
+
+void RenderThread::handle(Renderer& renderer, const InputMessage& message) {
+    if (message.type == InputMessage::Type::Key && message.code == GLFW_KEY_P && message.action == GLFW_PRESS) {
+        renderer.profiler()->printSummary(std::cout);
+    }
+}
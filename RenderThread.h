@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <string>
+#include <webgpu/webgpu.hpp>
+#include "SpscQueue.h"
+#include "SnapshotBuffer.h"
+#include "FramePacing.h"
+#include "RedrawScheduler.h"
+#include "Renderer.h"
+
+// Input events forwarded from the GLFW callbacks on the main thread
+struct InputMessage {
+    enum class Type : uint8_t { Key, MouseButton, CursorPos, Scroll, Resize, Invalidate };
+    Type type = Type::Invalidate;
+    int code = 0; // Key or mouse button, or width for Resize
+    int action = 0; // Or height for Resize
+    int mods = 0;
+    double x = 0.0;
+    double y = 0.0;
+};
+
+// Application state owned by the main thread, published as a whole every event loop iteration
+struct AppState {
+    int width = 0;
+    int height = 0;
+    bool pulsing = false;
+    double cursorX = 0.0;
+    double cursorY = 0.0;
+};
+
+// Frame statistics sent back to the main thread
+struct FrameReport {
+    uint64_t frames = 0;
+    double mean = 0.0;
+    double variance = 0.0;
+    double max = 0.0;
+};
+
+struct RenderSettings {
+    FramePacingConfig pacing;
+    RedrawMode redraw = RedrawMode::Continuous;
+    std::string tracePath; // Chrome trace of the last frames, written on exit
+    bool forceFallbackAdapter = false;
+    std::string capturePrefix; // Headless only, see RendererConfig
+    bool headless = false; // No window, renders headlessFrames frames offscreen then exits
+    uint32_t headlessFrames = 300;
+};
+
+// Runs the Renderer on its own thread so that a slow present never stalls input handling.
+// The main thread keeps GLFW and talks to the render thread through a lock-free SPSC queue
+// of input messages and a snapshot of the app state. The render thread creates, owns and
+// destroys the device, queue and swap chain.
+class RenderThread {
+public:
+    // jobs is shared with the renderer, which creates its own pool when null
+    explicit RenderThread(const RenderSettings& settings, JobSystem* jobs = nullptr);
+    ~RenderThread();
+
+    // Blocks until the renderer is initialized, returns false (and joins) if that failed
+    bool start(wgpu::Instance instance, wgpu::Surface surface, const AppState& initialState);
+    void stop();
+
+    // Main thread side
+    void post(const InputMessage& message);
+    void publish(const AppState& state);
+    bool pollReport(FrameReport& report) { return m_report.read(report); }
+
+private:
+    void run(Renderer& renderer, AppState state);
+    void handle(Renderer& renderer, const InputMessage& message);
+    void wake();
+    void sleep(double seconds);
+
+    RenderSettings m_settings;
+    JobSystem* m_jobs;
+    std::thread m_thread;
+    std::atomic<bool> m_quit{ false };
+    std::atomic<uint64_t> m_droppedMessages{ 0 };
+
+    SpscQueue<InputMessage, 1024> m_messages;
+    SnapshotBuffer<AppState> m_state;
+    SnapshotBuffer<FrameReport> m_report;
+
+    // Only used to park the render thread while it has nothing to draw
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    bool m_wakePending = false;
+};
@@ -0,0 +1,327 @@
+#include "Renderer.h"
+#include "FrameRing.h"
+#include "FrameProfiler.h"
+#include "FrameCapture.h"
+#include "StagingBelt.h"
+#include "RenderTargetPool.h"
+#include "BindGroupCache.h"
+#include "RenderBundleCache.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "PipelineCache.h"
+#include "PipelineManifest.h"
+#include "JobSystem.h"
+#include "TriangleScene.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+
+using namespace wgpu;
+
+Renderer::Renderer() = default;
+
+Renderer::~Renderer() {
+    terminate();
+}
+
+bool Renderer::initialize(Instance instance, Surface surface, const RendererConfig& config) {
+    m_surface = surface;
+
+    RequestAdapterOptions adapterOpts = {};
+    adapterOpts.nextInChain          = nullptr;
+    adapterOpts.compatibleSurface    = surface; // Null when headless
+    adapterOpts.forceFallbackAdapter = config.forceFallbackAdapter;
+    m_adapter = instance.requestAdapter(adapterOpts);
+    if (!m_adapter) return false;
+
+    AdapterProperties adapterProps;
+    m_adapter.getProperties(&adapterProps);
+    std::cout << "Adapter: " << (adapterProps.name ? adapterProps.name : "?");
+    if (adapterProps.adapterType == AdapterType::CPU) std::cout << " (CPU)";
+    std::cout << std::endl;
+
+    // Timestamp queries feed the GPU side of the frame profiler, the others GPU-driven drawing
+    std::vector<WGPUFeatureName> features;
+    const WGPUFeatureName optionalFeatures[] = {
+        FeatureName::TimestampQuery,
+        FeatureName::IndirectFirstInstance,
+        (WGPUFeatureName)NativeFeature::MultiDrawIndirect,
+        (WGPUFeatureName)NativeFeature::MultiDrawIndirectCount,
+    };
+    for (WGPUFeatureName feature : optionalFeatures) {
+        if (m_adapter.hasFeature(feature)) features.push_back(feature);
+    }
+
+    DeviceDescriptor deviceDesc = {};
+    deviceDesc.nextInChain              = nullptr;
+    deviceDesc.label                    = "Device";
+    deviceDesc.requiredFeaturesCount    = (uint32_t)features.size();
+    deviceDesc.requiredFeatures         = features.data();
+    deviceDesc.requiredLimits           = nullptr;
+    deviceDesc.defaultQueue.nextInChain = nullptr;
+    deviceDesc.defaultQueue.label       = "Default Queue";
+    m_device = m_adapter.requestDevice(deviceDesc);
+    if (!m_device) return false;
+    m_device.setUncapturedErrorCallback([](WGPUErrorType type, char const* message) {
+        std::cout << "Uncaptured device error: type " << type;
+        if (message) std::cout << " (" << message << ")";
+        std::cout << std::endl;
+    });
+
+    m_queue = m_device.getQueue();
+
+    // Last run's pipelines compile in the background while the swap chain and the rest are set up
+    const std::string& cacheDirectory = config.shaderCacheDirectory;
+    m_shaders = std::make_unique<ShaderCache>(m_device, RESOURCE_DIR "/shaders", cacheDirectory);
+    m_permutations = std::make_unique<ShaderPermutations>(*m_shaders, cacheDirectory.empty() ? "" : cacheDirectory + "/permutations.txt");
+    m_pipelines = std::make_unique<PipelineCache>(m_device);
+    if (!cacheDirectory.empty()) {
+        m_pipelineManifest = std::make_unique<PipelineManifest>(*m_shaders, *m_pipelines, cacheDirectory + "/pipelines.bin");
+        m_pipelineManifest->replay();
+        m_pipelines->setRecorder(m_pipelineManifest.get());
+    }
+
+    // Headless runs reuse the descriptor for their offscreen target's size and format
+    m_swapChainDesc = SwapChainDescriptor();
+    m_swapChainDesc.nextInChain = nullptr;
+    m_swapChainDesc.width       = config.width;
+    m_swapChainDesc.height      = config.height;
+    m_swapChainDesc.format      = surface ? surface.getPreferredFormat(m_adapter) : TextureFormat(TextureFormat::RGBA8Unorm);
+    m_swapChainDesc.usage       = WGPUTextureUsage_RenderAttachment;
+    m_swapChainDesc.presentMode = surface ? choosePresentMode(surface, m_adapter, config.pacing) : PresentMode(PresentMode::Immediate);
+    resize(config.width, config.height);
+    if (surface) {
+        std::cout << "Frame pacing: " << toString(config.pacing) << ", present mode " << toString(m_swapChainDesc.presentMode) << std::endl;
+    }
+
+    m_encoderDesc = CommandEncoderDescriptor();
+    m_encoderDesc.nextInChain = nullptr;
+    m_encoderDesc.label       = "Command Encoder";
+
+    m_colorAttachment = RenderPassColorAttachment();
+    m_colorAttachment.loadOp  = WGPULoadOp_Clear;
+    m_colorAttachment.storeOp = WGPUStoreOp_Store;
+
+    m_renderPassDesc = RenderPassDescriptor();
+    m_renderPassDesc.colorAttachmentCount = 1;
+    m_renderPassDesc.colorAttachments     = &m_colorAttachment;
+
+    m_commandBufferDesc = CommandBufferDescriptor();
+    m_commandBufferDesc.nextInChain = nullptr;
+    m_commandBufferDesc.label       = "Command buffer";
+
+    const uint32_t framesInFlight = 2;
+    m_fence = std::make_unique<Fence>(m_device, m_queue);
+    m_frames = std::make_unique<FrameRing>(*m_fence, framesInFlight);
+    m_profiler = std::make_unique<FrameProfiler>(m_device, 16, 4, config.profileHistory);
+    m_staging = std::make_unique<StagingBelt>(m_device);
+    m_bindGroups = std::make_unique<BindGroupCache>(*m_fence);
+    m_targets = std::make_unique<RenderTargetPool>(*m_fence);
+    m_targets->setBindGroupCache(m_bindGroups.get());
+    m_staticDraws = std::make_unique<RenderBundleCache>(*m_fence, m_swapChainDesc.format);
+    if (config.jobs) {
+        m_jobs = config.jobs;
+    } else {
+        m_ownJobs = std::make_unique<JobSystem>(); // Its main thread is this one
+        m_jobs = m_ownJobs.get();
+    }
+    if (!config.capturePrefix.empty()) {
+        if (surface) {
+            // The swap chain only hands out texture views, which cannot be copied from
+            std::cerr << "Frame capture is only supported with --headless" << std::endl;
+        } else {
+            m_capture = std::make_unique<FrameCapture>(m_device);
+            m_capturePrefix = config.capturePrefix;
+        }
+    }
+    return setScene(std::make_unique<TriangleScene>());
+}
+
+bool Renderer::setScene(std::unique_ptr<Scene> scene) {
+    waitIdle();
+    // The new scene's static draws go to a cache of their own: the current scene keeps its
+    // draws if the new one fails, and those of the failed scene are dropped with it
+    auto staticDraws = std::make_unique<RenderBundleCache>(*m_fence, m_swapChainDesc.format);
+    SceneResources resources{ m_device, m_swapChainDesc.format, *m_fence, *m_shaders, *m_permutations, *m_pipelines, *m_bindGroups, *m_targets, *staticDraws, *m_jobs };
+    if (!scene->initialize(resources)) {
+        std::cerr << "Could not initialize scene '" << scene->name() << "'" << std::endl;
+        return false;
+    }
+    m_staticDraws = std::move(staticDraws); // The previous ones reference the previous scene's objects
+    m_scene = std::move(scene);
+    return true;
+}
+
+void Renderer::terminate() {
+    if (!m_device) return;
+    if (m_capture) {
+        waitIdle();
+        m_capture.reset();
+    }
+    m_scene.reset();
+    m_ownJobs.reset(); // After the scene, whose jobs may still reference it
+    m_jobs = nullptr;
+    if (m_pipelineManifest) {
+        m_pipelineManifest->waitReplay();
+        if (!m_pipelineManifest->save()) std::cerr << "Could not write the pipeline manifest" << std::endl;
+        m_pipelines->setRecorder(nullptr);
+        m_pipelineManifest.reset();
+    }
+    m_pipelines.reset();
+    m_permutations.reset();
+    m_shaders.reset();
+    m_staticDraws.reset();
+    m_targets.reset(); // Invalidates its targets in the bind group cache
+    m_bindGroups.reset();
+    m_staging.reset();
+    m_profiler.reset();
+    m_frames.reset();
+    m_fence.reset();
+    if (m_swapChain) m_swapChain.release();
+    if (m_offscreen) {
+        m_offscreenView.release();
+        m_offscreen.destroy();
+        m_offscreen.release();
+    }
+    m_queue.release();
+    m_device.release();
+    m_adapter.release();
+    m_swapChain = nullptr;
+    m_offscreen = nullptr;
+    m_offscreenView = nullptr;
+    m_queue = nullptr;
+    m_device = nullptr;
+    m_adapter = nullptr;
+}
+
+void Renderer::resize(int width, int height) {
+    if (m_frames) m_frames->waitIdle();
+    if (m_swapChain) {
+        m_swapChain.release();
+        m_swapChain = nullptr;
+    }
+    if (m_offscreen) {
+        m_offscreenView.release();
+        m_offscreen.destroy();
+        m_offscreen.release();
+        m_offscreen = nullptr;
+        m_offscreenView = nullptr;
+    }
+    m_swapChainDesc.width  = width;
+    m_swapChainDesc.height = height;
+    if (width <= 0 || height <= 0) return;
+
+    if (m_surface) {
+        m_swapChain = m_device.createSwapChain(m_surface, m_swapChainDesc);
+        return;
+    }
+    TextureDescriptor textureDesc;
+    textureDesc.label           = "Offscreen target";
+    textureDesc.dimension       = TextureDimension::_2D;
+    textureDesc.size            = { (uint32_t)width, (uint32_t)height, 1 };
+    textureDesc.format          = m_swapChainDesc.format;
+    textureDesc.usage           = TextureUsage::RenderAttachment | TextureUsage::CopySrc;
+    textureDesc.mipLevelCount   = 1;
+    textureDesc.sampleCount     = 1;
+    textureDesc.viewFormatCount = 0;
+    textureDesc.viewFormats     = nullptr;
+    m_offscreen = m_device.createTexture(textureDesc);
+
+    TextureViewDescriptor viewDesc;
+    viewDesc.label           = "Offscreen target view";
+    viewDesc.format          = textureDesc.format;
+    viewDesc.dimension       = TextureViewDimension::_2D;
+    viewDesc.baseMipLevel    = 0;
+    viewDesc.mipLevelCount   = 1;
+    viewDesc.baseArrayLayer  = 0;
+    viewDesc.arrayLayerCount = 1;
+    viewDesc.aspect          = TextureAspect::All;
+    m_offscreenView = m_offscreen.createView(viewDesc);
+}
+
+void Renderer::waitIdle() {
+    if (m_frames) m_frames->waitIdle();
+    if (m_capture) m_capture->flush();
+}
+
+TextureView Renderer::acquireTarget() {
+    if (m_swapChain) return m_swapChain.getCurrentTextureView();
+    m_offscreenView.reference(); // The frame releases its target view like a swap chain one
+    return m_offscreenView;
+}
+
+void Renderer::presentTarget() {
+    if (m_swapChain) m_swapChain.present();
+}
+
+void Renderer::renderFrame(const FrameState& state) {
+    if (!m_swapChain && !m_offscreen) return; // Minimized
+    FrameProfiler& profiler = *m_profiler;
+    ProfileScope frameScope(profiler, "Frame");
+    {
+        ProfileScope scope(profiler, "Wait for frame slot");
+        m_frames->beginFrame(); // Waits for the frame that last used this slot to retire
+    }
+    profiler.beginFrame();
+    m_targets->beginFrame();
+    m_bindGroups->beginFrame();
+
+    // Per-frame objects are owned, they are released at the end of the frame at the latest
+    UniqueHandle<TextureView> RT;
+    {
+        ProfileScope scope(profiler, "Acquire");
+        RT.reset(acquireTarget());
+    }
+
+    {
+        ProfileScope scope(profiler, "Update");
+        m_scene->update(m_queue, *m_staging, state);
+    }
+
+    uint32_t encodeScope = profiler.beginCpu("Encode");
+    UniqueHandle<CommandEncoder> encoder(m_device.createCommandEncoder(m_encoderDesc));
+    m_staging->finish(encoder); // Uploads land before the pass that reads them
+    m_scene->encode(encoder);
+
+    m_colorAttachment.view          = RT;
+    m_colorAttachment.resolveTarget = nullptr; // For MSAA
+    m_colorAttachment.clearValue    = WGPUColor{ 0.0, sin(0.5 * state.pulseTime), 0.0, 1.0 };
+
+    uint32_t passScope = profiler.beginPass(encoder, "Main pass");
+    {
+        UniqueHandle<RenderPassEncoder> renderPass(encoder->beginRenderPass(m_renderPassDesc));
+        RenderPassRecorder recorder(renderPass);
+        m_staticDraws->execute(recorder);
+        m_scene->draw(recorder);
+        renderPass->end();
+        m_passStats += recorder.stats();
+    }
+    profiler.endPass(encoder, passScope);
+    if (m_capture && m_offscreen) {
+        ProfileScope scope(profiler, "Capture");
+        m_capture->update();
+        char frameName[16];
+        snprintf(frameName, sizeof(frameName), "%05llu", (unsigned long long)m_frames->frameIndex());
+        m_capture->capture(encoder, m_offscreen, m_swapChainDesc.format, m_swapChainDesc.width, m_swapChainDesc.height,
+                           m_capturePrefix + frameName + ".png");
+    }
+    profiler.resolve(encoder);
+
+    m_targets->endFrame();
+    UniqueHandle<CommandBuffer> command(encoder->finish(m_commandBufferDesc));
+    profiler.endCpu(encodeScope);
+    {
+        ProfileScope scope(profiler, "Submit");
+        m_frames->submit(1, &*command);
+    }
+    profiler.endFrame();
+    m_staging->recall();
+    if (m_capture) m_capture->endFrame();
+
+    RT.reset(); // The swap chain wants its view back before present
+    {
+        ProfileScope scope(profiler, "Present");
+        presentTarget();
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <webgpu/webgpu.hpp>
+#include "FramePacing.h"
+#include "Scene.h"
+#include "RenderPassRecorder.h"
+
+class FrameRing;
+class FrameProfiler;
+class FrameCapture;
+class StagingBelt;
+class RenderTargetPool;
+class BindGroupCache;
+class RenderBundleCache;
+class ShaderCache;
+class ShaderPermutations;
+class PipelineCache;
+class PipelineManifest;
+class JobSystem;
+
+struct RendererConfig {
+    int width = 800;
+    int height = 600;
+    PacingPolicy pacing = PacingPolicy::LowestPower;
+    bool forceFallbackAdapter = false; // Software/CPU adapter, e.g. on GPU-less CI machines
+    std::string capturePrefix; // When set, headless frames are written to <prefix><frame>.png
+    size_t profileHistory = 512; // Samples kept per profiler scope
+    std::string shaderCacheDirectory = "shader-cache"; // Preprocessed shaders and pipeline manifest for later launches, empty to disable
+    JobSystem* jobs = nullptr; // Shared with the application, the Renderer creates its own when null
+};
+
+// Owns the device, queue, swap chain and pipelines, and encodes/submits/presents frames.
+// Without a surface it runs headless and renders into an offscreen texture instead of the
+// swap chain, with the same frame code. Every call must come from the same thread.
+class Renderer {
+public:
+    Renderer();
+    ~Renderer();
+
+    // surface may be null for headless rendering. Starts with the TriangleScene.
+    bool initialize(wgpu::Instance instance, wgpu::Surface surface, const RendererConfig& config);
+    // Waits for in-flight frames, then replaces the current scene. Keeps the old one on failure.
+    bool setScene(std::unique_ptr<Scene> scene);
+    void terminate();
+    // Recreates the swap chain or offscreen target, a zero size pauses rendering
+    void resize(int width, int height);
+    void renderFrame(const FrameState& state);
+    // Blocks until all submitted frames have retired and their captures are written
+    void waitIdle();
+
+    FrameProfiler* profiler() { return m_profiler.get(); }
+    FrameCapture* capture() { return m_capture.get(); }
+    ShaderCache* shaders() { return m_shaders.get(); }
+    ShaderPermutations* permutations() { return m_permutations.get(); }
+    PipelineCache* pipelines() { return m_pipelines.get(); }
+    // Transient targets for the frame being rendered, e.g. for post-processing passes
+    RenderTargetPool* renderTargets() { return m_targets.get(); }
+    BindGroupCache* bindGroups() { return m_bindGroups.get(); }
+    RenderBundleCache* staticDraws() { return m_staticDraws.get(); }
+    JobSystem* jobs() { return m_jobs; }
+    // Draw state changes of the main pass since initialize(), and how many were redundant
+    const RenderPassRecorder::Stats& passStats() const { return m_passStats; }
+    void resetPassStats() { m_passStats = RenderPassRecorder::Stats(); }
+    bool headless() const { return !m_surface; }
+    wgpu::Device device() const { return m_device; }
+    // Headless render target, null when presenting to a surface
+    wgpu::Texture offscreenTexture() const { return m_offscreen; }
+    wgpu::TextureFormat targetFormat() const { return m_swapChainDesc.format; }
+    int width() const { return (int)m_swapChainDesc.width; }
+    int height() const { return (int)m_swapChainDesc.height; }
+
+private:
+    wgpu::TextureView acquireTarget();
+    void presentTarget();
+
+    wgpu::Surface m_surface = nullptr;
+    wgpu::Adapter m_adapter = nullptr;
+    wgpu::Device m_device = nullptr;
+    wgpu::Queue m_queue = nullptr;
+    wgpu::SwapChainDescriptor m_swapChainDesc;
+    wgpu::SwapChain m_swapChain = nullptr;
+    wgpu::Texture m_offscreen = nullptr;
+    wgpu::TextureView m_offscreenView = nullptr;
+    std::unique_ptr<ShaderCache> m_shaders; // Outlives the scenes
+    std::unique_ptr<ShaderPermutations> m_permutations;
+    std::unique_ptr<PipelineCache> m_pipelines;
+    std::unique_ptr<PipelineManifest> m_pipelineManifest;
+    std::unique_ptr<Scene> m_scene;
+    std::unique_ptr<wgpu::Fence> m_fence;
+    std::unique_ptr<FrameRing> m_frames;
+    std::unique_ptr<FrameProfiler> m_profiler;
+    std::unique_ptr<StagingBelt> m_staging;
+    std::unique_ptr<BindGroupCache> m_bindGroups;
+    std::unique_ptr<RenderTargetPool> m_targets; // Invalidates its targets in m_bindGroups
+    std::unique_ptr<RenderBundleCache> m_staticDraws; // Main pass draws that do not change
+    std::unique_ptr<FrameCapture> m_capture;
+    std::unique_ptr<JobSystem> m_ownJobs;
+    JobSystem* m_jobs = nullptr;
+    std::string m_capturePrefix;
+    RenderPassRecorder::Stats m_passStats;
+
+    wgpu::CommandEncoderDescriptor m_encoderDesc;
+    wgpu::RenderPassColorAttachment m_colorAttachment;
+    wgpu::RenderPassDescriptor m_renderPassDesc;
+    wgpu::CommandBufferDescriptor m_commandBufferDesc;
+};
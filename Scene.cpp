@@ -0,0 +1,60 @@
+#include "Scene.h"
+
+using namespace wgpu;
+
+ShaderModule createShaderModule(Device device, const char* shaderSource) {
+    ShaderModuleWGSLDescriptor shaderCodeDesc;
+    shaderCodeDesc.chain.next  = nullptr;
+    shaderCodeDesc.chain.sType = SType::ShaderModuleWGSLDescriptor;
+    shaderCodeDesc.code = shaderSource;
+
+    ShaderModuleDescriptor shaderDesc;
+#ifdef WEBGPU_BACKEND_WGPU
+    shaderDesc.hintCount = 0;
+    shaderDesc.hints = nullptr;
+#endif
+    shaderDesc.nextInChain = &shaderCodeDesc.chain;
+    return device.createShaderModule(shaderDesc);
+}
+
+BasicPipelineDescriptor::BasicPipelineDescriptor(ShaderModule shaderModule, TextureFormat targetFormat) {
+    blendState.color.srcFactor = BlendFactor::SrcAlpha;
+    blendState.color.dstFactor = BlendFactor::OneMinusSrcAlpha;
+    blendState.color.operation = BlendOperation::Add;
+
+    colorTarget.format    = targetFormat;
+    colorTarget.blend     = &blendState;
+    colorTarget.writeMask = ColorWriteMask::All;
+
+    fragmentState.module        = shaderModule;
+    fragmentState.entryPoint    = "fs_main";
+    fragmentState.constantCount = 0;
+    fragmentState.constants     = nullptr;
+    fragmentState.targetCount   = 1;
+    fragmentState.targets       = &colorTarget;
+
+    descriptor.vertex.bufferCount   = 0;
+    descriptor.vertex.buffers       = nullptr;
+    descriptor.vertex.module        = shaderModule;
+    descriptor.vertex.entryPoint    = "vs_main";
+    descriptor.vertex.constantCount = 0;
+    descriptor.vertex.constants     = nullptr;
+    descriptor.primitive.topology   = PrimitiveTopology::TriangleList;
+    descriptor.primitive.stripIndexFormat = IndexFormat::Undefined;
+    descriptor.primitive.frontFace  = FrontFace::CCW;
+    descriptor.primitive.cullMode   = CullMode::None;
+    descriptor.multisample.count    = 1;
+    descriptor.multisample.mask     = ~0u; // Default value for the mask, meaning "all bits on"
+    descriptor.multisample.alphaToCoverageEnabled = false;
+    descriptor.layout               = nullptr;
+    descriptor.fragment             = &fragmentState;
+    descriptor.depthStencil         = nullptr;
+}
+
+RenderPipeline createPipeline(Device device, TextureFormat targetFormat, const char* shaderSource) {
+    ShaderModule shaderModule = createShaderModule(device, shaderSource);
+    BasicPipelineDescriptor pipelineDesc(shaderModule, targetFormat);
+    RenderPipeline pipeline = device.createRenderPipeline(pipelineDesc.descriptor);
+    shaderModule.release();
+    return pipeline;
+}
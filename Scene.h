@@ -0,0 +1,67 @@
+#pragma once
+#include <webgpu/webgpu.hpp>
+
+class StagingBelt;
+class BindGroupCache;
+class RenderBundleCache;
+class RenderPassRecorder;
+class ShaderCache;
+class ShaderPermutations;
+class PipelineCache;
+class JobSystem;
+class RenderTargetPool;
+
+// Everything the frame code reads from the application, captured once per frame
+struct FrameState {
+    double pulseTime = 0.0;
+};
+
+// What scenes create their GPU objects with, handles and references to the Renderer's caches.
+// Shaders and pipelines from the caches outlive the scene. Draws added to staticDraws are
+// executed at the start of the main pass, before Scene::draw(), and cleared with the scene.
+struct SceneResources {
+    wgpu::Device device;
+    wgpu::TextureFormat targetFormat;
+    wgpu::Fence& fence; // Signaled with every frame's submission, outlives the scene
+    ShaderCache& shaders;
+    ShaderPermutations& permutations;
+    PipelineCache& pipelines;
+    BindGroupCache& bindGroups;
+    RenderTargetPool& targets; // Transient targets, released to the pool at the end of each frame
+    RenderBundleCache& staticDraws;
+    JobSystem& jobs; // Worker threads for parallel recording and other per-frame work
+};
+
+// What the Renderer draws into its main pass. The Renderer owns the scene, initializes it once
+// the device exists and destroys it before the device.
+class Scene {
+public:
+    virtual ~Scene() = default;
+
+    virtual const char* name() const = 0;
+    virtual bool initialize(SceneResources resources) = 0;
+    // Called before encoding to upload per-frame data. Many small uploads are cheaper through
+    // the staging belt, whose copies run before the main pass; large ones through the queue.
+    virtual void update(wgpu::Queue queue, StagingBelt& uploads, const FrameState& state) { (void)queue; (void)uploads; (void)state; }
+    // Records work the main pass depends on, e.g. compute passes, after the staging belt's copies
+    virtual void encode(wgpu::CommandEncoder encoder) { (void)encoder; }
+    virtual void draw(RenderPassRecorder& renderPass) = 0;
+};
+
+wgpu::ShaderModule createShaderModule(wgpu::Device device, const char* shaderSource);
+
+// Descriptor of an alpha blended pipeline without vertex buffers nor bind groups, for a module
+// with vs_main and fs_main entry points. Not copyable, the descriptor points into itself.
+struct BasicPipelineDescriptor {
+    BasicPipelineDescriptor(wgpu::ShaderModule shaderModule, wgpu::TextureFormat targetFormat);
+    BasicPipelineDescriptor(const BasicPipelineDescriptor&) = delete;
+    BasicPipelineDescriptor& operator=(const BasicPipelineDescriptor&) = delete;
+
+    wgpu::BlendState blendState;
+    wgpu::ColorTargetState colorTarget;
+    wgpu::FragmentState fragmentState;
+    wgpu::RenderPipelineDescriptor descriptor;
+};
+
+// Compiles a BasicPipelineDescriptor from WGSL. Returns null on failure.
+wgpu::RenderPipeline createPipeline(wgpu::Device device, wgpu::TextureFormat targetFormat, const char* shaderSource);
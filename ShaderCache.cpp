@@ -0,0 +1,357 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "Scene.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <cstdio>
+#include <cctype>
+
+using namespace wgpu;
+namespace fs = std::filesystem;
+
+namespace {
+bool readFile(const fs::path& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+bool isIdentifierStart(char c) { return std::isalpha((unsigned char)c) || c == '_'; }
+bool isIdentifierChar(char c) { return std::isalnum((unsigned char)c) || c == '_'; }
+
+class Preprocessor {
+public:
+    Preprocessor(const fs::path& shaderDirectory, const ShaderCache::Defines& defines, std::string& out, std::vector<std::string>* dependencies)
+        : m_shaderDirectory(shaderDirectory), m_out(out), m_dependencies(dependencies) {
+        for (const auto& define : defines) m_defines[define.first] = define.second;
+    }
+
+    bool file(const fs::path& path) {
+        fs::path canonical = fs::weakly_canonical(path);
+        if (std::find(m_included.begin(), m_included.end(), canonical) != m_included.end()) return true;
+        m_included.push_back(canonical);
+        std::string contents;
+        if (!readFile(canonical, contents)) {
+            std::cerr << "Could not read shader " << path.string() << std::endl;
+            return false;
+        }
+        if (m_dependencies) m_dependencies->push_back(canonical.string());
+
+        // Conditions of the enclosing #ifdef blocks, this file's only
+        std::vector<bool> active;
+        auto emitting = [&active]() { return std::all_of(active.begin(), active.end(), [](bool a) { return a; }); };
+        std::istringstream lines(contents);
+        std::string line;
+        for (uint32_t lineNumber = 1; std::getline(lines, line); lineNumber++) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line[start] != '#') {
+                if (emitting()) substitute(line);
+                continue;
+            }
+
+            std::istringstream directive(line.substr(start + 1));
+            std::string keyword, name;
+            directive >> keyword >> name;
+            auto fail = [&](const char* message) {
+                std::cerr << path.string() << ":" << lineNumber << ": " << message << std::endl;
+                return false;
+            };
+            if (keyword == "ifdef" || keyword == "ifndef") {
+                if (name.empty()) return fail("Expected a name");
+                active.push_back((m_defines.count(name) != 0) == (keyword == "ifdef"));
+            } else if (keyword == "else") {
+                if (active.empty()) return fail("#else without #ifdef");
+                active.back() = !active.back();
+            } else if (keyword == "endif") {
+                if (active.empty()) return fail("#endif without #ifdef");
+                active.pop_back();
+            } else if (!emitting()) {
+                continue;
+            } else if (keyword == "define") {
+                if (name.empty()) return fail("Expected a name");
+                std::string value;
+                std::getline(directive, value);
+                size_t first = value.find_first_not_of(" \t");
+                m_defines[name] = first == std::string::npos ? std::string() : value.substr(first);
+            } else if (keyword == "undef") {
+                m_defines.erase(name);
+            } else if (keyword == "include") {
+                if (name.size() < 2 || name.front() != '"' || name.back() != '"') return fail("Expected #include \"file\"");
+                fs::path include = name.substr(1, name.size() - 2);
+                fs::path resolved = canonical.parent_path() / include;
+                if (!fs::exists(resolved)) resolved = m_shaderDirectory / include;
+                if (!file(resolved)) return fail("Included from here");
+            } else {
+                return fail("Unknown directive");
+            }
+        }
+        if (!active.empty()) {
+            std::cerr << path.string() << ": Missing #endif" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void substitute(const std::string& line) {
+        if (m_defines.empty()) {
+            m_out += line;
+            m_out += '\n';
+            return;
+        }
+        for (size_t i = 0; i < line.size();) {
+            if (!isIdentifierStart(line[i]) || (i > 0 && isIdentifierChar(line[i - 1]))) {
+                m_out += line[i++];
+                continue;
+            }
+            size_t end = i;
+            while (end < line.size() && isIdentifierChar(line[end])) end++;
+            m_identifier.assign(line, i, end - i);
+            auto it = m_defines.find(m_identifier);
+            m_out += it != m_defines.end() ? it->second : m_identifier;
+            i = end;
+        }
+        m_out += '\n';
+    }
+
+    fs::path m_shaderDirectory;
+    std::string& m_out;
+    std::vector<std::string>* m_dependencies;
+    std::unordered_map<std::string, std::string> m_defines;
+    std::vector<fs::path> m_included;
+    std::string m_identifier;
+};
+
+// GLSL stage of a file from its extension, 0 for WGSL
+WGPUShaderStageFlags glslStage(const std::string& path) {
+    std::string extension = fs::path(path).extension().string();
+    if (extension == ".vert") return ShaderStage::Vertex;
+    if (extension == ".frag") return ShaderStage::Fragment;
+    if (extension == ".comp") return ShaderStage::Compute;
+    return 0;
+}
+
+// Changes whenever the file is written to, without reading it
+std::string fileStamp(const std::string& path) {
+    std::error_code error;
+    uint64_t size = fs::file_size(path, error);
+    if (error) return std::string();
+    auto time = fs::last_write_time(path, error);
+    if (error) return std::string();
+    return std::to_string(size) + " " + std::to_string((long long)time.time_since_epoch().count());
+}
+} // namespace
+
+ShaderCache::ShaderCache(Device device, std::string shaderDirectory, std::string cacheDirectory)
+    : m_device(device), m_shaderDirectory(std::move(shaderDirectory)), m_cacheDirectory(std::move(cacheDirectory)),
+      m_deviceThread(std::this_thread::get_id()) {
+    if (!m_cacheDirectory.empty()) {
+        std::error_code error;
+        fs::create_directories(m_cacheDirectory, error);
+        if (error) {
+            std::cerr << "Shader cache disabled, could not create " << m_cacheDirectory << std::endl;
+            m_cacheDirectory.clear();
+        }
+    }
+}
+
+ShaderCache::~ShaderCache() {
+    for (auto& bucket : m_modules) {
+        for (Module& module : bucket.second) {
+            if (module.module) module.module.release();
+        }
+    }
+}
+
+bool ShaderCache::preprocess(const std::string& path, const Defines& defines, std::string& source, std::vector<std::string>* dependencies) const {
+    Preprocessor preprocessor(m_shaderDirectory, defines, source, dependencies);
+    return preprocessor.file(fs::path(m_shaderDirectory) / path);
+}
+
+ShaderModule ShaderCache::load(const std::string& path, const Defines& defines) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Order independent, the same defines in any order are the same variant
+    Defines sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+    std::string key = path;
+    for (const auto& define : sorted) {
+        key += '\0'; // Cannot appear in paths nor defines
+        key += define.first + '=' + define.second;
+    }
+    auto it = m_loads.find(key);
+    if (it != m_loads.end()) {
+        m_stats.memoryHits++;
+        return it->second;
+    }
+
+    std::string source;
+#ifdef WEBGPU_BACKEND_WGPU
+    if (WGPUShaderStageFlags stage = glslStage(path)) {
+        if (!readFile(fs::path(m_shaderDirectory) / path, source)) {
+            std::cerr << "Could not read shader " << path << std::endl;
+            m_stats.failed++;
+            return nullptr;
+        }
+        Module* module = compile(source, path.c_str(), stage, &sorted);
+        if (!module) return nullptr;
+        m_loads.emplace(key, module->module);
+        return module->module;
+    }
+#endif
+
+    // Named by a hash of the key, the file holds the full key to tell collisions apart
+    std::string cachePath;
+    if (!m_cacheDirectory.empty() && key.find('\n') == std::string::npos) {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.wgsl", (unsigned long long)hashBytes(key.data(), key.size()));
+        cachePath = (fs::path(m_cacheDirectory) / name).string();
+    }
+    bool fromDisk = !cachePath.empty() && readDiskCache(cachePath, key, source);
+    std::vector<std::string> dependencies;
+    if (fromDisk) {
+        m_stats.diskHits++;
+    } else if (!preprocess(path, sorted, source, &dependencies)) {
+        m_stats.failed++;
+        return nullptr;
+    }
+
+    Module* module = compile(source, path.c_str());
+    if (!module) return nullptr;
+    // Unvalidated sources are cached too, preprocessing would produce the same source anyway
+    if (!fromDisk && !cachePath.empty()) writeDiskCache(cachePath, key, source, dependencies);
+    m_loads.emplace(key, module->module);
+    return module->module;
+}
+
+ShaderModule ShaderCache::fromSource(const std::string& source, const char* label) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Module* module = compile(source, label);
+    return module ? module->module : nullptr;
+}
+
+ShaderCache::Module* ShaderCache::compile(const std::string& source, const char* label, WGPUShaderStageFlags glslStage, const Defines* defines) {
+    std::string key = source;
+    if (defines) {
+        for (const auto& define : *defines) {
+            key += '\0';
+            key += define.first + '=' + define.second;
+        }
+    }
+    uint64_t hash = hashBytes(key.data(), key.size());
+    std::vector<Module>& bucket = m_modules[hash];
+    for (Module& module : bucket) {
+        if (module.source == key) {
+            m_stats.memoryHits++;
+            return &module;
+        }
+    }
+
+    // Shared with the error scope callback, which may outlive this call on some backends
+    struct Validation {
+        bool done = false;
+        bool ok = false;
+    };
+    auto validation = std::make_shared<Validation>();
+    Module module;
+    module.source = std::move(key);
+    bool scoped = std::this_thread::get_id() == m_deviceThread;
+    if (scoped) m_device.pushErrorScope(ErrorFilter::Validation);
+    if (glslStage == 0) {
+        module.module = createShaderModule(m_device, source.c_str());
+    } else {
+#ifdef WEBGPU_BACKEND_WGPU
+        std::vector<WGPUShaderDefine> glslDefines;
+        for (const auto& define : *defines) glslDefines.push_back({ define.first.c_str(), define.second.c_str() });
+        WGPUShaderModuleGLSLDescriptor shaderCodeDesc;
+        shaderCodeDesc.chain.next  = nullptr;
+        shaderCodeDesc.chain.sType = (WGPUSType)WGPUSType_ShaderModuleGLSLDescriptor;
+        shaderCodeDesc.stage       = (WGPUShaderStage)glslStage;
+        shaderCodeDesc.code        = source.c_str();
+        shaderCodeDesc.defineCount = (uint32_t)glslDefines.size();
+        shaderCodeDesc.defines     = glslDefines.data();
+
+        ShaderModuleDescriptor shaderDesc;
+        shaderDesc.hintCount = 0;
+        shaderDesc.hints = nullptr;
+        shaderDesc.nextInChain = &shaderCodeDesc.chain;
+        module.module = m_device.createShaderModule(shaderDesc);
+#endif
+    }
+    if (scoped) {
+        std::string name = label ? label : "";
+        m_device.popErrorScope([validation, name](ErrorType type, char const * message) {
+            validation->done = true;
+            validation->ok = type == ErrorType::NoError;
+            if (!validation->ok) std::cerr << "Shader " << name << ": " << (message ? message : "validation error") << std::endl;
+        });
+        if (!validation->done) m_device.poll(false, nullptr);
+    }
+    if (validation->done && !validation->ok) {
+        module.module.release();
+        m_stats.failed++;
+        return nullptr;
+    }
+    module.glsl = glslStage != 0;
+    m_stats.compiled++;
+    m_sourceHashes.emplace(module.module, hash);
+    bucket.push_back(std::move(module));
+    return &bucket.back();
+}
+
+bool ShaderCache::sourceOf(ShaderModule module, std::string& source) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sourceHashes.find(module);
+    if (it == m_sourceHashes.end()) return false;
+    for (const Module& entry : m_modules.at(it->second)) {
+        if (static_cast<WGPUShaderModule>(entry.module) != static_cast<WGPUShaderModule>(module) || entry.glsl) continue;
+        source = entry.source;
+        return true;
+    }
+    return false;
+}
+
+bool ShaderCache::readDiskCache(const std::string& cachePath, const std::string& key, std::string& source) const {
+    std::string contents;
+    if (!readFile(cachePath, contents)) return false;
+    // "// key <key>", header lines "// dep <size> <time> <path>" up to "// end", the source after
+    std::string keyLine = "// key " + key + "\n";
+    if (contents.compare(0, keyLine.size(), keyLine) != 0) return false; // Another load with the same hash
+    size_t position = keyLine.size();
+    while (true) {
+        size_t end = contents.find('\n', position);
+        if (end == std::string::npos) return false;
+        std::string line = contents.substr(position, end - position);
+        position = end + 1;
+        if (line == "// end") break;
+        std::istringstream header(line);
+        std::string comment, dep, size, time, path;
+        header >> comment >> dep >> size >> time;
+        std::getline(header, path);
+        if (dep != "dep" || path.size() < 2) return false;
+        if (fileStamp(path.substr(1)) != size + " " + time) return false; // Stale
+    }
+    source = contents.substr(position);
+    return true;
+}
+
+void ShaderCache::writeDiskCache(const std::string& cachePath, const std::string& key, const std::string& source, const std::vector<std::string>& dependencies) const {
+    std::string temporary = cachePath + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file) return;
+        file << "// key " << key << "\n";
+        for (const std::string& dependency : dependencies) file << "// dep " << fileStamp(dependency) << " " << dependency << "\n";
+        file << "// end\n" << source;
+        if (!file) return;
+    }
+    std::error_code error;
+    fs::rename(temporary, cachePath, error); // Readers never see a partial file
+}
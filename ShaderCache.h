@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+// Loads WGSL shaders through a small preprocessor and never compiles the same source twice.
+//
+// The preprocessor understands #include "file" (relative to the including file, then to the
+// shader directory, each file included once), #define NAME [value], #undef, #ifdef, #ifndef,
+// #else and #endif. Defined names are replaced in the source as whole identifiers.
+//
+// Modules are cached in memory by a content hash of the final source, and loads by file and
+// defines. With a cache directory, final sources that did not fail validation are also
+// written to disk together with the size and modification time of every file they were
+// made of, so that later launches skip preprocessing while those files are unchanged.
+//
+// With wgpu-native, .vert, .frag and .comp files are GLSL. They are not preprocessed here, their
+// defines go to the GLSL frontend through WGPUShaderModuleGLSLDescriptor instead.
+//
+// load() and fromSource() may be called from any thread, compiles are serialized. Error scopes
+// are one stack for the whole device, so only compiles on the thread that created the cache
+// (the one that owns the device) are validated in a scope: there an invalid module returns
+// null. Elsewhere the scope would also catch errors of the device thread's own calls, so the
+// module is returned unvalidated, its errors go to the device's uncaptured error callback and pipelines
+// made from it fail.
+class ShaderCache {
+public:
+    using Defines = std::vector<std::pair<std::string, std::string>>;
+
+    struct Stats {
+        uint32_t compiled = 0;
+        uint32_t memoryHits = 0;
+        uint32_t diskHits = 0;
+        uint32_t failed = 0;
+    };
+
+    // An empty cacheDirectory disables the disk cache
+    ShaderCache(wgpu::Device device, std::string shaderDirectory, std::string cacheDirectory = "");
+    ~ShaderCache();
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    // Modules are owned by the cache, null on failure
+    wgpu::ShaderModule load(const std::string& path, const Defines& defines = {});
+    wgpu::ShaderModule fromSource(const std::string& source, const char* label = nullptr);
+
+    // Final WGSL source of a module from this cache, false for GLSL and unknown modules
+    bool sourceOf(wgpu::ShaderModule module, std::string& source) const;
+
+    // Appends the preprocessed file to source, and every file read to dependencies if not null
+    bool preprocess(const std::string& path, const Defines& defines, std::string& source, std::vector<std::string>* dependencies = nullptr) const;
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    struct Module {
+        std::string source; // Followed by the defines for GLSL
+        wgpu::ShaderModule module = nullptr;
+        bool glsl = false;
+    };
+
+    Module* compile(const std::string& source, const char* label, WGPUShaderStageFlags glslStage = 0, const Defines* defines = nullptr);
+    bool readDiskCache(const std::string& cachePath, const std::string& key, std::string& source) const;
+    void writeDiskCache(const std::string& cachePath, const std::string& key, const std::string& source, const std::vector<std::string>& dependencies) const;
+
+    wgpu::Device m_device;
+    std::string m_shaderDirectory;
+    std::string m_cacheDirectory;
+    std::thread::id m_deviceThread;
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, std::vector<Module>> m_modules; // By source hash
+    std::unordered_map<std::string, wgpu::ShaderModule> m_loads; // By path and defines
+    std::unordered_map<WGPUShaderModule, uint64_t> m_sourceHashes; // Where each module is in m_modules
+    Stats m_stats;
+};
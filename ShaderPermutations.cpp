@@ -0,0 +1,155 @@
+#include "ShaderPermutations.h"
+#include "ShaderCache.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+using namespace wgpu;
+
+ShaderPermutations::ShaderPermutations(ShaderCache& shaders, std::string manifestPath)
+    : m_shaders(shaders), m_manifestPath(std::move(manifestPath)) {
+    if (!m_manifestPath.empty()) {
+        // One variant per line: the shader path, a tab, then its enabled features
+        std::ifstream file(m_manifestPath);
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos) continue;
+            std::vector<std::string> features;
+            std::istringstream names(line.substr(tab + 1));
+            for (std::string name; names >> name;) features.push_back(name);
+            m_manifest.emplace_back(line.substr(0, tab), std::move(features));
+        }
+    }
+    m_worker = std::thread([this]() { workerMain(); });
+}
+
+ShaderPermutations::~ShaderPermutations() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+        m_queue.clear();
+    }
+    m_workAvailable.notify_all();
+    m_worker.join();
+    if (!m_manifestPath.empty() && !saveManifest()) std::cerr << "Could not write shader manifest " << m_manifestPath << std::endl;
+}
+
+uint32_t ShaderPermutations::declare(const std::string& path, std::vector<std::string> features) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < (uint32_t)m_shaderList.size(); i++) {
+        if (m_shaderList[i].path == path) return i;
+    }
+    if (features.size() > MaxFeatures) {
+        std::cerr << "Shader " << path << " declares " << features.size() << " features, only the first " << MaxFeatures << " are used" << std::endl;
+        features.resize(MaxFeatures);
+    }
+    uint32_t shader = (uint32_t)m_shaderList.size();
+    m_shaderList.push_back({ path, std::move(features), {} });
+
+    for (const auto& saved : m_manifest) {
+        if (saved.first != path) continue;
+        uint64_t mask = 0;
+        const std::vector<std::string>& declared = m_shaderList[shader].features;
+        for (const std::string& name : saved.second) {
+            for (size_t bit = 0; bit < declared.size(); bit++) {
+                if (declared[bit] == name) mask |= 1ull << bit; // Features since removed are dropped
+            }
+        }
+        if (m_shaderList[shader].variants.count(mask) == 0) m_stats.prewarmed++;
+        request(shader, mask, false);
+    }
+    return shader;
+}
+
+ShaderPermutations::Variant& ShaderPermutations::request(uint32_t shader, uint64_t mask, bool use) {
+    auto inserted = m_shaderList[shader].variants.emplace(mask, Variant());
+    Variant& variant = inserted.first->second;
+    if (inserted.second) {
+        m_stats.requested++;
+        m_queue.emplace_back(shader, mask);
+        m_workAvailable.notify_one();
+    }
+    variant.used |= use;
+    return variant;
+}
+
+ShaderModule ShaderPermutations::get(uint32_t shader, uint64_t mask) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Variant& variant = request(shader, mask, true);
+    return variant.state == State::Ready ? variant.module : nullptr;
+}
+
+ShaderModule ShaderPermutations::wait(uint32_t shader, uint64_t mask) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const Variant& variant = request(shader, mask, true);
+    m_variantDone.wait(lock, [&variant]() { return variant.state != State::Queued; });
+    return variant.module;
+}
+
+uint64_t ShaderPermutations::featureBit(uint32_t shader, const std::string& feature) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::vector<std::string>& features = m_shaderList[shader].features;
+    for (size_t bit = 0; bit < features.size(); bit++) {
+        if (features[bit] == feature) return 1ull << bit;
+    }
+    return 0;
+}
+
+void ShaderPermutations::workerMain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_workAvailable.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+        if (m_quit) return;
+        uint32_t shader = m_queue.front().first;
+        uint64_t mask = m_queue.front().second;
+        m_queue.pop_front();
+        const Shader& entry = m_shaderList[shader];
+        std::string path = entry.path;
+        ShaderCache::Defines defines;
+        for (size_t bit = 0; bit < entry.features.size(); bit++) {
+            if (mask & (1ull << bit)) defines.emplace_back(entry.features[bit], "1");
+        }
+        lock.unlock();
+
+        ShaderModule module = m_shaders.load(path, defines);
+
+        lock.lock();
+        Variant& variant = m_shaderList[shader].variants.at(mask);
+        variant.module = module;
+        variant.state  = module ? State::Ready : State::Failed;
+        if (module) m_stats.compiled++; else m_stats.failed++;
+        m_variantDone.notify_all();
+    }
+}
+
+bool ShaderPermutations::saveManifest() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::ofstream file(m_manifestPath);
+    if (!file) return false;
+    for (const Shader& shader : m_shaderList) {
+        for (const auto& entry : shader.variants) {
+            if (!entry.second.used || entry.second.state == State::Failed) continue;
+            file << shader.path << '\t';
+            for (size_t bit = 0; bit < shader.features.size(); bit++) {
+                if (entry.first & (1ull << bit)) file << shader.features[bit] << ' ';
+            }
+            file << '\n';
+        }
+    }
+    // Shaders this run did not declare keep the variants of earlier runs
+    for (const auto& saved : m_manifest) {
+        bool declared = false;
+        for (const Shader& shader : m_shaderList) declared |= shader.path == saved.first;
+        if (declared) continue;
+        file << saved.first << '\t';
+        for (const std::string& feature : saved.second) file << feature << ' ';
+        file << '\n';
+    }
+    return (bool)file;
+}
+
+ShaderPermutations::Stats ShaderPermutations::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+class ShaderCache;
+
+// Variants of shaders with optional features, compiled on demand on a background thread.
+//
+// A shader declares up to 64 features, each a define set for the variants that enable its bit.
+// Only the masks actually requested are ever compiled: get() returns the module once it is
+// ready and otherwise queues the variant and returns null, for the caller to skip the draw or
+// use another variant. The masks requested during a run are saved to a manifest, along with the
+// saved masks of shaders the run did not declare, and the next run starts compiling exactly
+// those as soon as their shader is declared. Variants compile off
+// the device thread, so the ShaderCache cannot validate them: only variants that fail to
+// preprocess are reported failed, invalid WGSL shows up when pipelines are created from it.
+class ShaderPermutations {
+public:
+    static const uint32_t MaxFeatures = 64; // Bits of a mask
+    struct Stats {
+        uint32_t requested = 0; // Distinct variants
+        uint32_t compiled = 0;
+        uint32_t failed = 0;
+        uint32_t prewarmed = 0; // Queued from the manifest
+    };
+
+    // An empty manifestPath disables the manifest
+    ShaderPermutations(ShaderCache& shaders, std::string manifestPath = "");
+    // Waits for the compilation in progress, then saves the manifest
+    ~ShaderPermutations();
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    // Feature i is bit i of the masks, features past MaxFeatures are dropped with an error.
+    // Declaring the same path again returns the same id.
+    uint32_t declare(const std::string& path, std::vector<std::string> features);
+    // Never blocks, null until the variant is compiled or when it failed
+    wgpu::ShaderModule get(uint32_t shader, uint64_t mask);
+    // Blocks until the variant is compiled, for variants a frame cannot do without
+    wgpu::ShaderModule wait(uint32_t shader, uint64_t mask);
+    // Bit of a feature by name, 0 if the shader does not declare it
+    uint64_t featureBit(uint32_t shader, const std::string& feature) const;
+
+    bool saveManifest() const;
+    Stats stats() const;
+
+private:
+    enum class State { Queued, Ready, Failed };
+    struct Variant {
+        State state = State::Queued;
+        wgpu::ShaderModule module = nullptr; // Owned by the shader cache
+        bool used = false; // Requested this run, rather than only prewarmed
+    };
+    struct Shader {
+        std::string path;
+        std::vector<std::string> features;
+        std::unordered_map<uint64_t, Variant> variants;
+    };
+
+    Variant& request(uint32_t shader, uint64_t mask, bool use); // Needs the lock
+    void workerMain();
+
+    ShaderCache& m_shaders;
+    std::string m_manifestPath;
+    std::vector<std::pair<std::string, std::vector<std::string>>> m_manifest; // Path and features of saved variants
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_variantDone;
+    std::deque<Shader> m_shaderList; // Stable addresses, wait() holds on to variants
+    std::deque<std::pair<uint32_t, uint64_t>> m_queue;
+    bool m_quit = false;
+    Stats m_stats;
+    std::thread m_worker;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free latest-value handoff between one writer and one reader thread. The writer fills
+// its back buffer and publishes it, the reader swaps in the most recently published one as
+// its front buffer. A third, published slot sits between the two, so neither side ever
+// waits for the other or sees a half-written value.
+template <typename T>
+class SnapshotBuffer {
+public:
+    // Writer thread
+    void write(const T& value) {
+        m_slots[m_back] = value;
+        uint8_t previous = m_published.exchange(uint8_t(m_back | kFresh), std::memory_order_acq_rel);
+        m_back = previous & kIndexMask;
+    }
+
+    // Reader thread, returns true if a new value was published since the last read
+    bool read(T& value) {
+        bool fresh = (m_published.load(std::memory_order_relaxed) & kFresh) != 0;
+        if (fresh) {
+            uint8_t previous = m_published.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & kIndexMask;
+        }
+        value = m_slots[m_front];
+        return fresh;
+    }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+    T m_slots[3] = {};
+    uint8_t m_front = 0; // Owned by the reader
+    uint8_t m_back = 2;  // Owned by the writer
+    std::atomic<uint8_t> m_published{ 1 };
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free single-producer/single-consumer ring. push() is only called from the
+// producer thread and pop() only from the consumer thread. Each side keeps a cached copy
+// of the other side's index so that the shared cache lines are only touched when the
+// ring looks full (producer) or empty (consumer).
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+    bool push(const T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tailCache == Capacity) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tailCache == Capacity) return false; // Full
+        }
+        m_items[head & (Capacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_headCache) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail == m_headCache) return false; // Empty
+        }
+        value = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+    alignas(kCacheLine) std::atomic<size_t> m_head{ 0 }; // Written by the producer
+    size_t m_tailCache = 0;
+    alignas(kCacheLine) std::atomic<size_t> m_tail{ 0 }; // Written by the consumer
+    size_t m_headCache = 0;
+    alignas(kCacheLine) T m_items[Capacity];
+};
@@ -0,0 +1,143 @@
+#include "StagingBelt.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+using namespace wgpu;
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+StagingBelt::StagingBelt(Device device, uint64_t chunkSize) : m_device(device), m_chunkSize(chunkSize) {
+    m_device.reference();
+}
+
+StagingBelt::~StagingBelt() {
+    bool mapping = false;
+    for (auto& chunk : m_chunks) mapping |= chunk->state == Chunk::State::Mapping;
+    if (mapping) m_device.poll(true, nullptr); // Map callbacks reference the chunks
+    for (auto& chunk : m_chunks) {
+        chunk->buffer.destroy();
+        chunk->buffer.release();
+    }
+    m_device.release();
+}
+
+uint8_t* StagingBelt::allocate(uint64_t size, uint64_t alignment, Chunk*& chunk, uint64_t& offset) {
+    chunk = nullptr;
+    for (auto& candidate : m_chunks) {
+        if (candidate->state != Chunk::State::Active) continue;
+        if (alignUp(candidate->used, alignment) + size <= candidate->size) {
+            chunk = candidate.get();
+            break;
+        }
+    }
+    if (!chunk) {
+        for (auto& candidate : m_chunks) {
+            if (candidate->state == Chunk::State::Free && candidate->size >= size) {
+                chunk = candidate.get();
+                break;
+            }
+        }
+    }
+    if (!chunk) {
+        auto created = std::make_unique<Chunk>();
+        created->size = std::max(m_chunkSize, alignUp(size, 4));
+        BufferDescriptor bufferDesc;
+        bufferDesc.label            = "Staging belt chunk";
+        bufferDesc.size             = created->size;
+        bufferDesc.usage            = BufferUsage::MapWrite | BufferUsage::CopySrc;
+        bufferDesc.mappedAtCreation = true;
+        created->buffer = m_device.createBuffer(bufferDesc);
+        created->mapped = static_cast<uint8_t*>(created->buffer.getMappedRange(0, created->size));
+        chunk = created.get();
+        m_chunks.push_back(std::move(created));
+    }
+    chunk->state = Chunk::State::Active;
+    offset = alignUp(chunk->used, alignment);
+    chunk->used = offset + size;
+    return chunk->mapped + offset;
+}
+
+void* StagingBelt::writeBuffer(Buffer destination, uint64_t offset, uint64_t size) {
+    assert(offset % 4 == 0 && size % 4 == 0); // copyBufferToBuffer requirement
+    Chunk* chunk;
+    uint64_t sourceOffset;
+    uint8_t* memory = allocate(size, 4, chunk, sourceOffset);
+
+    // Sequential writes to a contiguous range become a single copy
+    if (!m_bufferCopies.empty()) {
+        BufferCopy& last = m_bufferCopies.back();
+        if (last.chunk == chunk && static_cast<WGPUBuffer>(last.destination) == static_cast<WGPUBuffer>(destination) && last.sourceOffset + last.size == sourceOffset
+            && last.destinationOffset + last.size == offset) {
+            last.size += size;
+            return memory;
+        }
+    }
+    m_bufferCopies.push_back({ chunk, sourceOffset, destination, offset, size });
+    return memory;
+}
+
+void StagingBelt::writeBuffer(Buffer destination, uint64_t offset, const void* data, uint64_t size) {
+    memcpy(writeBuffer(destination, offset, size), data, size);
+}
+
+void StagingBelt::writeTexture(const ImageCopyTexture& destination, const void* data, const TextureDataLayout& dataLayout,
+                               const Extent3D& writeSize) {
+    // Rows of a block, i.e. texel rows for uncompressed formats
+    uint32_t rowsPerImage = dataLayout.rowsPerImage ? dataLayout.rowsPerImage : writeSize.height;
+    uint64_t rowCount = (uint64_t)rowsPerImage * writeSize.depthOrArrayLayers;
+    uint32_t bytesPerRow = (uint32_t)alignUp(dataLayout.bytesPerRow, 256);
+
+    Chunk* chunk;
+    uint64_t sourceOffset;
+    uint8_t* memory = allocate(bytesPerRow * rowCount, 256, chunk, sourceOffset);
+    const uint8_t* source = static_cast<const uint8_t*>(data) + dataLayout.offset;
+    for (uint64_t row = 0; row < rowCount; row++) {
+        memcpy(memory + row * bytesPerRow, source + row * dataLayout.bytesPerRow, dataLayout.bytesPerRow);
+    }
+
+    TextureCopy copy = { chunk, destination, dataLayout, writeSize };
+    copy.layout.offset       = sourceOffset;
+    copy.layout.bytesPerRow  = bytesPerRow;
+    copy.layout.rowsPerImage = rowsPerImage;
+    m_textureCopies.push_back(copy);
+}
+
+void StagingBelt::finish(CommandEncoder encoder) {
+    for (const BufferCopy& copy : m_bufferCopies) {
+        encoder.copyBufferToBuffer(copy.chunk->buffer, copy.sourceOffset, copy.destination, copy.destinationOffset, copy.size);
+    }
+    for (const TextureCopy& copy : m_textureCopies) {
+        ImageCopyBuffer source;
+        source.buffer = copy.chunk->buffer;
+        source.layout = copy.layout;
+        encoder.copyBufferToTexture(source, copy.destination, copy.size);
+    }
+    m_copiesRecorded += m_bufferCopies.size() + m_textureCopies.size();
+    m_bufferCopies.clear();
+    m_textureCopies.clear();
+
+    for (auto& chunk : m_chunks) {
+        if (chunk->state != Chunk::State::Active) continue;
+        chunk->buffer.unmap();
+        chunk->mapped = nullptr;
+        chunk->state  = Chunk::State::Closed;
+    }
+}
+
+void StagingBelt::recall() {
+    for (auto& c : m_chunks) {
+        if (c->state != Chunk::State::Closed) continue;
+        Chunk* chunk = c.get();
+        chunk->state = Chunk::State::Mapping;
+        // Resolves once the submission that reads the chunk has retired
+        chunk->buffer.mapAsync(MapMode::Write, 0, chunk->size, [chunk](BufferMapAsyncStatus status) {
+            if (status != BufferMapAsyncStatus::Success) return; // Device lost or destroyed, stays unusable
+            chunk->mapped = static_cast<uint8_t*>(chunk->buffer.getMappedRange(0, chunk->size));
+            chunk->used   = 0;
+            chunk->state  = Chunk::State::Free;
+        });
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <webgpu/webgpu.hpp>
+
+// Batches uploads through large mapped staging buffers instead of one Queue::writeBuffer or
+// writeTexture per piece of data.
+//
+// Uploads are sub-allocated from chunks created with mappedAtCreation and written with a
+// memcpy. finish() records one copyBufferToBuffer per run of contiguous writes to the same
+// buffer (plus one copyBufferToTexture per texture write) and unmaps the chunks. recall(),
+// after submit, maps them again: the mapping completes once their submission has retired,
+// which puts the chunk back on the free list. The cost of a frame's uploads is then
+// dominated by the bytes copied rather than the number of calls.
+class StagingBelt {
+public:
+    StagingBelt(wgpu::Device device, uint64_t chunkSize = 1 << 20);
+    ~StagingBelt();
+    StagingBelt(const StagingBelt&) = delete;
+    StagingBelt& operator=(const StagingBelt&) = delete;
+
+    // Returns size bytes of mapped memory, copied to destination at offset by finish().
+    // offset and size must be multiples of 4, the memory is only valid until finish().
+    void* writeBuffer(wgpu::Buffer destination, uint64_t offset, uint64_t size);
+    void writeBuffer(wgpu::Buffer destination, uint64_t offset, const void* data, uint64_t size);
+    // Same arguments as Queue::writeTexture, rows are re-padded to the 256 bytes copies need
+    void writeTexture(const wgpu::ImageCopyTexture& destination, const void* data, const wgpu::TextureDataLayout& dataLayout,
+                      const wgpu::Extent3D& writeSize);
+
+    // Records the pending copies at the current position of the encoder, e.g. before the
+    // passes that read the data, and unmaps the chunks they read from
+    void finish(wgpu::CommandEncoder encoder);
+    // Call after the encoder's commands were submitted
+    void recall();
+
+    uint64_t chunkCount() const { return m_chunks.size(); }
+    uint64_t copiesRecorded() const { return m_copiesRecorded; }
+
+private:
+    struct Chunk {
+        enum class State { Free, Active, Closed, Mapping };
+        State state = State::Free;
+        wgpu::Buffer buffer = nullptr;
+        uint64_t size = 0;
+        uint64_t used = 0;
+        uint8_t* mapped = nullptr;
+    };
+    struct BufferCopy {
+        Chunk* chunk;
+        uint64_t sourceOffset;
+        wgpu::Buffer destination;
+        uint64_t destinationOffset;
+        uint64_t size;
+    };
+    struct TextureCopy {
+        Chunk* chunk;
+        wgpu::ImageCopyTexture destination;
+        wgpu::TextureDataLayout layout;
+        wgpu::Extent3D size;
+    };
+
+    // Mapped memory at a multiple of alignment, returns the chunk and the offset in it
+    uint8_t* allocate(uint64_t size, uint64_t alignment, Chunk*& chunk, uint64_t& offset);
+
+    wgpu::Device m_device;
+    uint64_t m_chunkSize;
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    std::vector<BufferCopy> m_bufferCopies;
+    std::vector<TextureCopy> m_textureCopies;
+    uint64_t m_copiesRecorded = 0;
+};
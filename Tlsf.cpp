@@ -0,0 +1,220 @@
+#include "Tlsf.h"
+#include <algorithm>
+#include <cassert>
+
+static uint32_t log2Floor(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (uint32_t)index;
+#else
+    return 63 - (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+static uint32_t lowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctzll(value);
+#endif
+}
+
+Tlsf::Tlsf(uint64_t granularity) : m_granularity(granularity) {
+    for (auto& heads : m_heads) {
+        for (uint32_t& head : heads) head = kInvalid;
+    }
+}
+
+void Tlsf::mapping(uint64_t units, uint32_t& fl, uint32_t& sl) const {
+    if (units < kSlCount) {
+        fl = 0;
+        sl = (uint32_t)units;
+        return;
+    }
+    uint32_t log = log2Floor(units);
+    fl = log - kSlBits + 1;
+    sl = (uint32_t)(units >> (log - kSlBits)) - kSlCount;
+}
+
+uint32_t Tlsf::newBlock() {
+    if (!m_unusedBlocks.empty()) {
+        uint32_t block = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+        m_blocks[block] = Block();
+        return block;
+    }
+    m_blocks.emplace_back();
+    return (uint32_t)m_blocks.size() - 1;
+}
+
+void Tlsf::releaseBlock(uint32_t block) {
+    m_unusedBlocks.push_back(block);
+}
+
+void Tlsf::insertFree(uint32_t block) {
+    Block& b = m_blocks[block];
+    uint32_t fl, sl;
+    mapping(b.size / m_granularity, fl, sl);
+    b.prevFree = kInvalid;
+    b.nextFree = m_heads[fl][sl];
+    if (b.nextFree != kInvalid) m_blocks[b.nextFree].prevFree = block;
+    m_heads[fl][sl] = block;
+    m_flBitmap |= 1ull << fl;
+    m_slBitmaps[fl] |= 1u << sl;
+    b.listed = true;
+}
+
+void Tlsf::removeFree(uint32_t block) {
+    Block& b = m_blocks[block];
+    if (b.prevFree != kInvalid) {
+        m_blocks[b.prevFree].nextFree = b.nextFree;
+    } else {
+        uint32_t fl, sl;
+        mapping(b.size / m_granularity, fl, sl);
+        m_heads[fl][sl] = b.nextFree;
+        if (b.nextFree == kInvalid) {
+            m_slBitmaps[fl] &= ~(1u << sl);
+            if (m_slBitmaps[fl] == 0) m_flBitmap &= ~(1ull << fl);
+        }
+    }
+    if (b.nextFree != kInvalid) m_blocks[b.nextFree].prevFree = b.prevFree;
+    b.prevFree = b.nextFree = kInvalid;
+    b.listed = false;
+}
+
+uint32_t Tlsf::addRegion(uint64_t size) {
+    assert(size > 0 && size % m_granularity == 0);
+    Region region;
+    region.size  = size;
+    region.first = newBlock();
+    Block& b = m_blocks[region.first];
+    b.size   = size;
+    b.region = (uint32_t)m_regions.size();
+    b.free   = true;
+    m_regions.push_back(region);
+    insertFree(region.first);
+    return b.region;
+}
+
+void Tlsf::removeRegion(uint32_t region) {
+    Region& r = m_regions[region];
+    assert(r.allocated == 0 && !r.removed);
+    if (m_blocks[r.first].listed) removeFree(r.first);
+    releaseBlock(r.first);
+    r.first   = kInvalid;
+    r.removed = true;
+}
+
+void Tlsf::setRegionEnabled(uint32_t region, bool enabled) {
+    Region& r = m_regions[region];
+    if (r.enabled == enabled || r.removed) return;
+    r.enabled = enabled;
+    for (uint32_t block = r.first; block != kInvalid; block = m_blocks[block].nextPhysical) {
+        if (!m_blocks[block].free) continue;
+        if (enabled) insertFree(block); else removeFree(block);
+    }
+}
+
+uint64_t Tlsf::searchUnits(uint64_t units) const {
+    // Round up to the next bin boundary so that any block of the bin found is large enough
+    if (units >= kSlCount) units += (1ull << (log2Floor(units) - kSlBits)) - 1;
+    return units;
+}
+
+uint64_t Tlsf::regionSizeFor(uint64_t size) const {
+    uint64_t units = searchUnits(std::max<uint64_t>(1, (size + m_granularity - 1) / m_granularity));
+    if (units >= kSlCount) units &= ~((1ull << (log2Floor(units) - kSlBits)) - 1); // Start of its bin
+    return units * m_granularity;
+}
+
+uint32_t Tlsf::allocate(uint64_t size) {
+    uint64_t units = (size + m_granularity - 1) / m_granularity;
+    if (units == 0) units = 1;
+    size = units * m_granularity;
+
+    uint64_t searchUnits = this->searchUnits(units);
+    uint32_t fl, sl;
+    mapping(searchUnits, fl, sl);
+    if (fl >= kFlCount) return kInvalid;
+
+    uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0) {
+        uint64_t flMap = fl + 1 < kFlCount ? m_flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) return kInvalid;
+        fl = lowestBit(flMap);
+        slMap = m_slBitmaps[fl];
+    }
+    sl = lowestBit(slMap);
+    uint32_t block = m_heads[fl][sl];
+    removeFree(block);
+
+    // Split off the remainder
+    Block& b = m_blocks[block];
+    if (b.size > size) {
+        uint32_t rest = newBlock();
+        Block& r = m_blocks[rest]; // newBlock() may have moved m_blocks
+        Block& found = m_blocks[block];
+        r.offset       = found.offset + size;
+        r.size         = found.size - size;
+        r.region       = found.region;
+        r.free         = true;
+        r.prevPhysical = block;
+        r.nextPhysical = found.nextPhysical;
+        if (r.nextPhysical != kInvalid) m_blocks[r.nextPhysical].prevPhysical = rest;
+        found.nextPhysical = rest;
+        found.size = size;
+        insertFree(rest);
+    }
+    Block& allocated = m_blocks[block];
+    allocated.free = false;
+    m_regions[allocated.region].allocated += allocated.size;
+    m_allocations++;
+    return block;
+}
+
+void Tlsf::free(uint32_t block) {
+    assert(!m_blocks[block].free);
+    Region& region = m_regions[m_blocks[block].region];
+    region.allocated -= m_blocks[block].size;
+    m_allocations--;
+    m_blocks[block].free = true;
+
+    // Merge with the free neighbours
+    uint32_t next = m_blocks[block].nextPhysical;
+    if (next != kInvalid && m_blocks[next].free) {
+        if (m_blocks[next].listed) removeFree(next);
+        m_blocks[block].size += m_blocks[next].size;
+        m_blocks[block].nextPhysical = m_blocks[next].nextPhysical;
+        if (m_blocks[block].nextPhysical != kInvalid) m_blocks[m_blocks[block].nextPhysical].prevPhysical = block;
+        releaseBlock(next);
+    }
+    uint32_t prev = m_blocks[block].prevPhysical;
+    if (prev != kInvalid && m_blocks[prev].free) {
+        if (m_blocks[prev].listed) removeFree(prev);
+        m_blocks[prev].size += m_blocks[block].size;
+        m_blocks[prev].nextPhysical = m_blocks[block].nextPhysical;
+        if (m_blocks[prev].nextPhysical != kInvalid) m_blocks[m_blocks[prev].nextPhysical].prevPhysical = prev;
+        releaseBlock(block);
+        block = prev;
+    }
+    if (region.enabled) insertFree(block);
+}
+
+Tlsf::Stats Tlsf::stats() const {
+    Stats stats;
+    stats.allocations = m_allocations;
+    for (const Region& region : m_regions) {
+        if (region.removed) continue;
+        stats.capacity  += region.size;
+        stats.allocated += region.allocated;
+        for (uint32_t block = region.first; block != kInvalid; block = m_blocks[block].nextPhysical) {
+            if (!m_blocks[block].free) continue;
+            stats.freeBlocks++;
+            if (m_blocks[block].size > stats.largestFree) stats.largestFree = m_blocks[block].size;
+        }
+    }
+    return stats;
+}
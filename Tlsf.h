@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// Two-Level Segregated Fit allocator over offsets, with O(1) allocate and free.
+//
+// Free blocks are binned by size: the first level is the power of two, the second splits each
+// power of two into 16 linear steps. Two bitmaps find the smallest non-empty bin that is large
+// enough in constant time, and freed blocks merge with their free neighbours right away.
+// Address space comes in regions (e.g. one per GPU buffer) that blocks never straddle.
+// All sizes and offsets are multiples of the granularity.
+class Tlsf {
+public:
+    static constexpr uint32_t kInvalid = UINT32_MAX;
+
+    struct Stats {
+        uint64_t capacity = 0;
+        uint64_t allocated = 0;
+        uint64_t largestFree = 0;
+        uint32_t allocations = 0;
+        uint32_t freeBlocks = 0;
+        // 0 when all free space is one block, towards 1 as it splinters
+        double fragmentation() const { return capacity > allocated ? 1.0 - (double)largestFree / (double)(capacity - allocated) : 0.0; }
+    };
+
+    explicit Tlsf(uint64_t granularity = 256);
+
+    uint32_t addRegion(uint64_t size);
+    // The smallest region that allocate(size) is guaranteed to succeed in
+    uint64_t regionSizeFor(uint64_t size) const;
+    // Only for empty regions, their id is not reused
+    void removeRegion(uint32_t region);
+    // Disabled regions keep their allocations but are never allocated from
+    void setRegionEnabled(uint32_t region, bool enabled);
+    uint32_t regionCount() const { return (uint32_t)m_regions.size(); }
+    bool regionRemoved(uint32_t region) const { return m_regions[region].removed; }
+    uint64_t regionSize(uint32_t region) const { return m_regions[region].size; }
+    uint64_t regionAllocated(uint32_t region) const { return m_regions[region].allocated; }
+
+    // Returns a block id, or kInvalid when no enabled region has a large enough free block
+    uint32_t allocate(uint64_t size);
+    void free(uint32_t block);
+
+    uint64_t offset(uint32_t block) const { return m_blocks[block].offset; }
+    uint64_t size(uint32_t block) const { return m_blocks[block].size; }
+    uint32_t region(uint32_t block) const { return m_blocks[block].region; }
+    // Blocks of a region in address order, free ones included
+    uint32_t firstBlock(uint32_t region) const { return m_regions[region].first; }
+    uint32_t nextBlock(uint32_t block) const { return m_blocks[block].nextPhysical; }
+    bool isFree(uint32_t block) const { return m_blocks[block].free; }
+
+    Stats stats() const;
+
+private:
+    static constexpr uint32_t kSlBits = 4;
+    static constexpr uint32_t kSlCount = 1 << kSlBits;
+    static constexpr uint32_t kFlCount = 64;
+
+    struct Block {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t region = 0;
+        uint32_t prevPhysical = kInvalid;
+        uint32_t nextPhysical = kInvalid;
+        uint32_t prevFree = kInvalid;
+        uint32_t nextFree = kInvalid;
+        bool free = false;
+        bool listed = false; // In a free list, i.e. free in an enabled region
+    };
+    struct Region {
+        uint64_t size = 0;
+        uint64_t allocated = 0;
+        uint32_t first = kInvalid;
+        bool enabled = true;
+        bool removed = false;
+    };
+
+    void mapping(uint64_t units, uint32_t& fl, uint32_t& sl) const;
+    uint64_t searchUnits(uint64_t units) const;
+    uint32_t newBlock();
+    void insertFree(uint32_t block);
+    void removeFree(uint32_t block);
+    void releaseBlock(uint32_t block);
+
+    uint64_t m_granularity;
+    std::vector<Block> m_blocks;
+    std::vector<uint32_t> m_unusedBlocks;
+    std::vector<Region> m_regions;
+    uint64_t m_flBitmap = 0;
+    uint32_t m_slBitmaps[kFlCount] = {};
+    uint32_t m_heads[kFlCount][kSlCount];
+    uint32_t m_allocations = 0;
+};
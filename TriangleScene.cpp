@@ -0,0 +1,19 @@
+#include "TriangleScene.h"
+#include "ShaderCache.h"
+#include "PipelineCache.h"
+#include "RenderPassRecorder.h"
+
+using namespace wgpu;
+
+bool TriangleScene::initialize(SceneResources resources) {
+    ShaderModule shaderModule = resources.shaders.load("triangle.wgsl");
+    if (!shaderModule) return false;
+    BasicPipelineDescriptor pipelineDesc(shaderModule, resources.targetFormat);
+    m_pipeline = resources.pipelines.wait(pipelineDesc.descriptor); // Usually replayed from the manifest by now
+    return m_pipeline != nullptr;
+}
+
+void TriangleScene::draw(RenderPassRecorder& renderPass) {
+    renderPass.setPipeline(m_pipeline);
+    renderPass.draw(3, 1, 0, 0); // Draw triangle
+}
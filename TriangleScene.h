@@ -0,0 +1,13 @@
+#pragma once
+#include "Scene.h"
+
+// The red triangle
+class TriangleScene : public Scene {
+public:
+    const char* name() const override { return "triangle"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    wgpu::RenderPipeline m_pipeline = nullptr;
+};
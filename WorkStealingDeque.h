@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded Chase-Lev deque (with the C11 memory orders of Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models"). The owner thread push()es and pop()s at the bottom,
+// in LIFO order, any other thread steal()s from the top. Only the last item is contended:
+// owner and thieves then race on a compare-exchange of the top index.
+template <typename T, size_t Capacity>
+class WorkStealingDeque {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+    // Owner only, returns false when full
+    bool push(T* item) {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= (int64_t)Capacity) return false;
+        m_items[bottom & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only, the most recently pushed item or null
+    T* pop() {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed); // Empty
+            return nullptr;
+        }
+        T* item = m_items[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last item, thieves may be after it too
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) item = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread, the oldest item or null when empty or when another thread got it first
+    T* steal() {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) return nullptr;
+        T* item = m_items[top & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+        return item;
+    }
+
+    bool empty() const {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+    alignas(kCacheLine) std::atomic<int64_t> m_top{ 0 };    // Advanced by thieves, and by the owner for the last item
+    alignas(kCacheLine) std::atomic<int64_t> m_bottom{ 0 }; // Written by the owner
+    alignas(kCacheLine) std::atomic<T*> m_items[Capacity] = {};
+};
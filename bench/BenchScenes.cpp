@@ -0,0 +1,617 @@
+#include "BenchScenes.h"
+#include "StagingBelt.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "RenderPassRecorder.h"
+#include "RenderBundleCache.h"
+#include "BindGroupCache.h"
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+using namespace wgpu;
+
+// Instance i draws a small triangle in cell i of a grid x grid layout covering the target
+static std::string gridShader(uint32_t grid, float red, float green) {
+    std::string source = "const grid = " + std::to_string(grid) + "u;\n";
+    source += R"(
+        @vertex
+        fn vs_main(@builtin(vertex_index) in_vertex_index: u32, @builtin(instance_index) in_instance_index: u32) -> @builtin(position) vec4f {
+            let cell = 2.0 / f32(grid);
+            let origin = vec2f(f32(in_instance_index % grid), f32(in_instance_index / grid)) * cell - 1.0;
+            var p = vec2f(0.1, 0.1);
+            if (in_vertex_index == 1u) {
+                p = vec2f(0.9, 0.1);
+            } else if (in_vertex_index == 2u) {
+                p = vec2f(0.5, 0.9);
+            }
+            return vec4f(origin + p * cell, 0.0, 1.0);
+        }
+
+        @fragment
+        fn fs_main() -> @location(0) vec4f {
+    )";
+    source += "    return vec4f(" + std::to_string(red) + ", " + std::to_string(green) + ", 1.0, 1.0);\n}\n";
+    return source;
+}
+
+static uint32_t gridSize(uint32_t count) {
+    return std::max(1u, (uint32_t)std::ceil(std::sqrt((double)count)));
+}
+
+ManyDrawsScene::~ManyDrawsScene() {
+    if (m_pipeline) m_pipeline.release();
+}
+
+bool ManyDrawsScene::initialize(SceneResources resources) {
+    m_pipeline = createPipeline(resources.device, resources.targetFormat, gridShader(gridSize(m_drawCount), 1.0f, 0.5f).c_str());
+    return m_pipeline != nullptr;
+}
+
+void ManyDrawsScene::draw(RenderPassRecorder& renderPass) {
+    renderPass.setPipeline(m_pipeline);
+    for (uint32_t i = 0; i < m_drawCount; i++) renderPass.draw(3, 1, 0, i);
+}
+
+StaticDrawsScene::~StaticDrawsScene() {
+    if (m_pipeline) m_pipeline.release();
+}
+
+bool StaticDrawsScene::initialize(SceneResources resources) {
+    m_pipeline = createPipeline(resources.device, resources.targetFormat, gridShader(gridSize(m_drawCount), 0.5f, 1.0f).c_str());
+    if (!m_pipeline) return false;
+    for (uint32_t i = 0; i < m_drawCount; i++) {
+        DrawQueue::Draw draw;
+        draw.pipeline      = m_pipeline;
+        draw.count         = 3;
+        draw.firstInstance = i;
+        resources.staticDraws.add(i / 1024, draw);
+    }
+    return true;
+}
+
+ManyPipelinesScene::~ManyPipelinesScene() {
+    for (RenderPipeline pipeline : m_pipelines) pipeline.release();
+}
+
+bool ManyPipelinesScene::initialize(SceneResources resources) {
+    uint32_t grid = gridSize(m_pipelineCount);
+    for (uint32_t i = 0; i < m_pipelineCount; i++) {
+        // Distinct sources so that no layer can deduplicate the pipelines
+        float shade = (float)i / (float)m_pipelineCount;
+        RenderPipeline pipeline = createPipeline(resources.device, resources.targetFormat, gridShader(grid, shade, 1.0f - shade).c_str());
+        if (!pipeline) return false;
+        m_pipelines.push_back(pipeline);
+    }
+    return true;
+}
+
+void ManyPipelinesScene::draw(RenderPassRecorder& renderPass) {
+    for (uint32_t i = 0; i < (uint32_t)m_pipelines.size(); i++) {
+        renderPass.setPipeline(m_pipelines[i]);
+        renderPass.draw(3, 1, 0, i);
+    }
+}
+
+CachedPipelinesScene::~CachedPipelinesScene() {
+    m_cache.reset();
+    if (m_standIn) m_standIn.release();
+}
+
+bool CachedPipelinesScene::initialize(SceneResources resources) {
+    uint32_t grid = gridSize(m_pipelineCount);
+    m_cache = std::make_unique<PipelineCache>(resources.device, m_fallback);
+    if (m_fallback == PipelineCache::Fallback::StandIn) {
+        m_standIn = createPipeline(resources.device, resources.targetFormat, gridShader(grid, 0.5f, 0.5f).c_str());
+        if (!m_standIn) return false;
+    }
+    for (uint32_t i = 0; i < m_pipelineCount; i++) {
+        float shade = (float)i / (float)m_pipelineCount;
+        ShaderModule shaderModule = resources.shaders.fromSource(gridShader(grid, shade, 1.0f - shade));
+        if (!shaderModule) return false;
+        m_descriptors.push_back(std::make_unique<BasicPipelineDescriptor>(shaderModule, resources.targetFormat));
+    }
+    return true;
+}
+
+void CachedPipelinesScene::draw(RenderPassRecorder& renderPass) {
+    for (uint32_t i = 0; i < (uint32_t)m_descriptors.size(); i++) {
+        RenderPipeline pipeline = m_cache->get(m_descriptors[i]->descriptor, m_standIn);
+        if (!pipeline) continue; // Still compiling
+        renderPass.setPipeline(pipeline);
+        renderPass.draw(3, 1, 0, i);
+    }
+}
+
+SortedDrawsScene::~SortedDrawsScene() {
+    for (RenderPipeline pipeline : m_pipelines) pipeline.release();
+}
+
+bool SortedDrawsScene::initialize(SceneResources resources) {
+    uint32_t grid = gridSize(m_drawCount);
+    for (uint32_t i = 0; i < m_pipelineCount; i++) {
+        float shade = (float)i / (float)m_pipelineCount;
+        RenderPipeline pipeline = createPipeline(resources.device, resources.targetFormat, gridShader(grid, shade, 1.0f - shade).c_str());
+        if (!pipeline) return false;
+        m_pipelines.push_back(pipeline);
+    }
+    return true;
+}
+
+void SortedDrawsScene::draw(RenderPassRecorder& renderPass) {
+    submitDraws();
+    m_queue.replay(renderPass, 0);
+}
+
+void SortedDrawsScene::submitDraws() {
+    m_queue.begin();
+    for (uint32_t i = 0; i < m_drawCount; i++) {
+        uint32_t hash = i * 2654435761u; // Same scrambled order every frame
+        DrawQueue::Draw draw;
+        draw.pipeline      = m_pipelines[hash % m_pipelineCount];
+        draw.count         = 3;
+        draw.firstInstance = i;
+        m_queue.submit(0, draw, 0, (float)(hash >> 8) / (float)(1u << 24));
+    }
+    if (m_sort) m_queue.sort();
+}
+
+bool ParallelDrawsScene::initialize(SceneResources resources) {
+    if (!SortedDrawsScene::initialize(resources)) return false;
+    m_recorder = std::make_unique<ParallelRecorder>(resources.jobs, resources.fence, resources.targetFormat);
+    m_recorder->setMinDrawsPerBundle(m_minDrawsPerBundle);
+    return true;
+}
+
+void ParallelDrawsScene::draw(RenderPassRecorder& renderPass) {
+    submitDraws();
+    m_draws.clear();
+    m_queue.collect(0, m_draws);
+    m_recorder->record(renderPass, m_draws.data(), (uint32_t)m_draws.size());
+}
+
+// Instance i draws a triangle inside the bounding circle of culled object i
+static const char* culledShader = R"(
+    struct Object {
+        center: vec3f,
+        radius: f32,
+        indexCount: u32,
+        firstIndex: u32,
+        baseVertex: i32,
+        padding: u32,
+    }
+
+    @group(0) @binding(0) var<uniform> viewProjection: mat4x4f;
+    @group(0) @binding(1) var<storage, read> objects: array<Object>;
+
+    @vertex
+    fn vs_main(@builtin(vertex_index) in_vertex_index: u32, @builtin(instance_index) in_instance_index: u32) -> @builtin(position) vec4f {
+        let object = objects[in_instance_index];
+        var p = vec2f(-0.7, -0.5);
+        if (in_vertex_index == 1u) {
+            p = vec2f(0.7, -0.5);
+        } else if (in_vertex_index == 2u) {
+            p = vec2f(0.0, 0.9);
+        }
+        return viewProjection * vec4f(object.center + vec3f(p * object.radius, 0.0), 1.0);
+    }
+
+    @fragment
+    fn fs_main() -> @location(0) vec4f {
+        return vec4f(1.0, 0.8, 0.2, 1.0);
+    }
+)";
+
+CulledDrawsScene::~CulledDrawsScene() {
+    m_culling.reset();
+    if (m_bindGroup) m_bindGroup.release();
+    if (m_pipeline) m_pipeline.release();
+    for (Buffer* buffer : { &m_camera, &m_indices }) {
+        if (!*buffer) continue;
+        buffer->destroy();
+        buffer->release();
+    }
+}
+
+bool CulledDrawsScene::initialize(SceneResources resources) {
+    if (!GpuCulling::supported(resources.device)) {
+        std::cerr << "The culled scene needs the IndirectFirstInstance feature" << std::endl;
+        return false;
+    }
+    m_culling = std::make_unique<GpuCulling>(m_drawCount);
+    if (!m_culling->initialize(resources)) return false;
+
+    // World x in [-2, 2] and y in [-1, 1], the view shows half of it
+    uint32_t columns = gridSize(2 * m_drawCount);
+    uint32_t rows = (m_drawCount + columns - 1) / columns;
+    float cellWidth = 4.0f / (float)columns;
+    float cellHeight = 2.0f / (float)std::max(1u, rows);
+    for (uint32_t i = 0; i < m_drawCount; i++) {
+        GpuCulling::Object object;
+        object.center[0]  = -2.0f + ((float)(i % columns) + 0.5f) * cellWidth;
+        object.center[1]  = -1.0f + ((float)(i / columns) + 0.5f) * cellHeight;
+        object.radius     = 0.4f * std::min(cellWidth, cellHeight);
+        object.indexCount = 3;
+        m_culling->add(object);
+    }
+
+    m_pipeline = createPipeline(resources.device, resources.targetFormat, culledShader);
+    if (!m_pipeline) return false;
+
+    BufferDescriptor bufferDesc;
+    bufferDesc.label            = "Culled camera";
+    bufferDesc.size             = 16 * sizeof(float);
+    bufferDesc.usage            = BufferUsage::Uniform | BufferUsage::CopyDst;
+    bufferDesc.mappedAtCreation = false;
+    m_camera = resources.device.createBuffer(bufferDesc);
+    const uint32_t indices[3] = { 0, 1, 2 };
+    bufferDesc.label            = "Culled indices";
+    bufferDesc.size             = sizeof(indices);
+    bufferDesc.usage            = BufferUsage::Index;
+    bufferDesc.mappedAtCreation = true;
+    m_indices = resources.device.createBuffer(bufferDesc);
+    if (!m_camera || !m_indices) return false;
+    memcpy(m_indices.getMappedRange(0, sizeof(indices)), indices, sizeof(indices));
+    m_indices.unmap();
+
+    std::vector<BindGroupEntry> entries(2, BindGroupEntry());
+    Buffer buffers[] = { m_camera, m_culling->objects() };
+    for (uint32_t i = 0; i < 2; i++) {
+        entries[i].nextInChain = nullptr;
+        entries[i].binding     = i;
+        entries[i].buffer      = buffers[i];
+        entries[i].offset      = 0;
+        entries[i].size        = buffers[i].getSize();
+        entries[i].sampler     = nullptr;
+        entries[i].textureView = nullptr;
+    }
+    BindGroupLayout layout = m_pipeline.getBindGroupLayout(0);
+    BindGroupDescriptor bindGroupDesc = BindGroupDescriptor();
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label       = "Culled objects";
+    bindGroupDesc.layout      = layout;
+    bindGroupDesc.entryCount  = (uint32_t)entries.size();
+    bindGroupDesc.entries     = entries.data();
+    m_bindGroup = resources.device.createBindGroup(bindGroupDesc);
+    layout.release();
+    return m_bindGroup != nullptr;
+}
+
+void CulledDrawsScene::update(Queue queue, StagingBelt&, const FrameState& state) {
+    // Orthographic, panning along x so that a changing half of the grid is visible
+    float viewProjection[16] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f,
+        -1.5f * (float)std::sin(0.5 * state.pulseTime), 0.0f, 0.5f, 1.0f,
+    };
+    queue.writeBuffer(m_camera, 0, viewProjection, sizeof(viewProjection));
+    m_culling->update(queue, viewProjection);
+}
+
+void CulledDrawsScene::encode(CommandEncoder encoder) {
+    m_culling->cull(encoder);
+}
+
+void CulledDrawsScene::draw(RenderPassRecorder& renderPass) {
+    renderPass.setPipeline(m_pipeline);
+    renderPass.setBindGroup(0, m_bindGroup);
+    renderPass.setIndexBuffer(m_indices, IndexFormat::Uint32);
+    m_culling->draw(renderPass);
+}
+
+// Vertex positions in xy, vec4f for the uniform array stride
+static const char* allocatorShader = R"(
+    @group(0) @binding(0) var<uniform> vertices: array<vec4f, 3>;
+
+    @vertex
+    fn vs_main(@builtin(vertex_index) in_vertex_index: u32) -> @builtin(position) vec4f {
+        return vec4f(vertices[in_vertex_index].xy, 0.0, 1.0);
+    }
+
+    @fragment
+    fn fs_main() -> @location(0) vec4f {
+        return vec4f(0.4, 1.0, 0.6, 1.0);
+    }
+)";
+
+static const uint64_t TriangleSize = 3 * 4 * sizeof(float);
+
+AllocatorScene::~AllocatorScene() {
+    m_allocator.reset(); // Waits for the frames that still read its pages
+    if (m_layout) m_layout.release();
+    if (m_pipeline) m_pipeline.release();
+}
+
+bool AllocatorScene::initialize(SceneResources resources) {
+    m_pipeline = createPipeline(resources.device, resources.targetFormat, allocatorShader);
+    if (!m_pipeline) return false;
+    m_layout = m_pipeline.getBindGroupLayout(0);
+    m_bindGroups = &resources.bindGroups;
+
+    // Small pages so that a few thousand triangles span many of them
+    m_allocator = std::make_unique<BufferAllocator>(resources.fence, BufferUsage::Uniform, 256 << 10, 256, "Allocator scene page");
+    m_allocator->setBindGroupCache(m_bindGroups);
+    m_triangles.resize(m_drawCount); // Allocated by the first update()
+    return true;
+}
+
+void AllocatorScene::allocate(Queue queue, uint32_t triangle) {
+    // Allocation sizes between 256 B and 4 KiB, following a slow wave so that pages fill up
+    // and then empty out, with only the first 48 bytes bound
+    double wave = 0.5 + 0.5 * std::sin((double)m_frame / 60.0);
+    uint32_t blocks = 1 + (uint32_t)(wave * (double)((triangle * 7u) % 16u));
+    m_allocator->free(m_triangles[triangle]);
+    m_triangles[triangle] = m_allocator->allocate(256ull * blocks);
+    if (!m_triangles[triangle]) return;
+
+    uint32_t grid = gridSize(m_drawCount);
+    float cell = 2.0f / (float)grid;
+    float x = -1.0f + (float)(triangle % grid) * cell;
+    float y = -1.0f + (float)(triangle / grid) * cell;
+    const float vertices[12] = {
+        x + 0.1f * cell, y + 0.1f * cell, 0.0f, 0.0f,
+        x + 0.9f * cell, y + 0.1f * cell, 0.0f, 0.0f,
+        x + 0.5f * cell, y + 0.9f * cell, 0.0f, 0.0f,
+    };
+    queue.writeBuffer(m_triangles[triangle].buffer, m_triangles[triangle].offset, vertices, sizeof(vertices));
+}
+
+void AllocatorScene::update(Queue queue, StagingBelt&, const FrameState&) {
+    uint32_t count = m_frame == 0 ? m_drawCount : std::max(1u, m_drawCount / 16);
+    for (uint32_t i = 0; i < count; i++) {
+        allocate(queue, m_next);
+        m_next = (m_next + 1) % m_drawCount;
+    }
+    m_frame++;
+}
+
+void AllocatorScene::encode(CommandEncoder encoder) {
+    // The Renderer submits the encoder with the frame's Fence::signal, as defragment() requires
+    // Groups of the old ranges idle out of the cache, those of emptied pages are dropped
+    std::vector<BufferAllocator::Move> moves = m_allocator->defragment(encoder);
+    if (moves.empty()) return;
+    for (BufferAllocation& triangle : m_triangles) {
+        if (triangle) m_allocator->update(triangle);
+    }
+}
+
+void AllocatorScene::draw(RenderPassRecorder& renderPass) {
+    BindGroupEntry entry = BindGroupEntry();
+    entry.nextInChain = nullptr;
+    entry.binding     = 0;
+    entry.size        = TriangleSize;
+    entry.sampler     = nullptr;
+    entry.textureView = nullptr;
+    BindGroupDescriptor bindGroupDesc = BindGroupDescriptor();
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label       = "Allocator triangle";
+    bindGroupDesc.layout      = m_layout;
+    bindGroupDesc.entryCount  = 1;
+    bindGroupDesc.entries     = &entry;
+
+    renderPass.setPipeline(m_pipeline);
+    for (const BufferAllocation& triangle : m_triangles) {
+        if (!triangle) continue;
+        entry.buffer = triangle.buffer;
+        entry.offset = triangle.offset;
+        renderPass.setBindGroup(0, m_bindGroups->get(bindGroupDesc));
+        renderPass.draw(3);
+    }
+}
+
+bool PermutationsScene::initialize(SceneResources resources) {
+    m_permutations = &resources.permutations;
+    m_pipelines = &resources.pipelines;
+    m_targetFormat = resources.targetFormat;
+    m_wgsl = m_permutations->declare("variants.wgsl", { "SHRINK", "RED", "BLUE" });
+    m_vertex = m_permutations->declare("variants.vert", { "SHRINK" });
+    m_fragment = m_permutations->declare("variants.frag", { "RED", "BLUE" });
+    m_descriptors.resize(2 * VariantCount);
+    return true;
+}
+
+const BasicPipelineDescriptor* PermutationsScene::descriptor(uint32_t cell) {
+    // Cells 0 to 31 cycle through the WGSL masks, 32 to 63 through the GLSL pairs
+    bool glsl = cell >= 32;
+    uint32_t variant = cell % VariantCount;
+    std::unique_ptr<BasicPipelineDescriptor>& slot = m_descriptors[(glsl ? VariantCount : 0) + variant];
+    if (slot) return slot.get();
+    if (!glsl) {
+        ShaderModule shaderModule = m_permutations->get(m_wgsl, variant);
+        if (shaderModule) slot = std::make_unique<BasicPipelineDescriptor>(shaderModule, m_targetFormat);
+        return slot.get();
+    }
+    ShaderModule vertexModule = m_permutations->get(m_vertex, variant & 1);
+    ShaderModule fragmentModule = m_permutations->get(m_fragment, variant >> 1);
+    if (!vertexModule || !fragmentModule) return nullptr;
+    slot = std::make_unique<BasicPipelineDescriptor>(vertexModule, m_targetFormat);
+    slot->descriptor.vertex.entryPoint = "main";
+    slot->fragmentState.module         = fragmentModule;
+    slot->fragmentState.entryPoint     = "main";
+    return slot.get();
+}
+
+void PermutationsScene::draw(RenderPassRecorder& renderPass) {
+    for (uint32_t cell = 0; cell < 64; cell++) {
+        const BasicPipelineDescriptor* pipelineDesc = descriptor(cell);
+        RenderPipeline pipeline = pipelineDesc ? m_pipelines->get(pipelineDesc->descriptor) : nullptr;
+        if (!pipeline) continue; // Still compiling
+        renderPass.setPipeline(pipeline);
+        renderPass.draw(3, 1, 0, cell);
+    }
+}
+
+// Averages the source around each pixel, over a fullscreen triangle
+static const char* filterShader = R"(
+    @group(0) @binding(0) var source: texture_2d<f32>;
+
+    @vertex
+    fn vs_main(@builtin(vertex_index) in_vertex_index: u32) -> @builtin(position) vec4f {
+        let uv = vec2f(f32((in_vertex_index << 1u) & 2u), f32(in_vertex_index & 2u));
+        return vec4f(uv * 2.0 - 1.0, 0.0, 1.0);
+    }
+
+    @fragment
+    fn fs_main(@builtin(position) position: vec4f) -> @location(0) vec4f {
+        let last = vec2i(textureDimensions(source)) - 1;
+        let center = vec2i(position.xy);
+        var sum = vec4f(0.0);
+        for (var y = -1; y <= 1; y++) {
+            for (var x = -1; x <= 1; x++) {
+                sum += textureLoad(source, clamp(center + vec2i(x, y), vec2i(0), last), 0);
+            }
+        }
+        return vec4f(sum.rgb / 9.0, 1.0);
+    }
+)";
+
+PostProcessScene::~PostProcessScene() {
+    if (m_layout) m_layout.release();
+    for (RenderPipeline* pipeline : { &m_scenePipeline, &m_filterPipeline, &m_showPipeline }) {
+        if (*pipeline) pipeline->release();
+    }
+}
+
+bool PostProcessScene::initialize(SceneResources resources) {
+    m_targets = &resources.targets;
+    m_bindGroups = &resources.bindGroups;
+    m_targetDesc.format = TextureFormat::RGBA8Unorm;
+    m_targetDesc.width  = 512;
+    m_targetDesc.height = 512;
+    m_scenePipeline = createPipeline(resources.device, m_targetDesc.format, gridShader(gridSize(m_drawCount), 1.0f, 0.5f).c_str());
+    m_filterPipeline = createPipeline(resources.device, m_targetDesc.format, filterShader);
+    m_showPipeline = createPipeline(resources.device, resources.targetFormat, filterShader);
+    if (!m_scenePipeline || !m_filterPipeline || !m_showPipeline) return false;
+    m_layout = m_filterPipeline.getBindGroupLayout(0); // The same for both, from the same module
+    return m_layout != nullptr;
+}
+
+BindGroup PostProcessScene::sourceGroup(const RenderTarget& source) {
+    // The pool hands out the same views every frame, so after the first frame these are hits
+    BindGroupEntry entry = BindGroupEntry();
+    entry.nextInChain = nullptr;
+    entry.binding     = 0;
+    entry.buffer      = nullptr;
+    entry.offset      = 0;
+    entry.size        = 0;
+    entry.sampler     = nullptr;
+    entry.textureView = source.view;
+    BindGroupDescriptor bindGroupDesc = BindGroupDescriptor();
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label       = "Post-process source";
+    bindGroupDesc.layout      = m_layout;
+    bindGroupDesc.entryCount  = 1;
+    bindGroupDesc.entries     = &entry;
+    return m_bindGroups->get(bindGroupDesc);
+}
+
+static RenderPassEncoder beginTargetPass(CommandEncoder encoder, const RenderTarget& target) {
+    RenderPassColorAttachment colorAttachment = RenderPassColorAttachment();
+    colorAttachment.view          = target.view;
+    colorAttachment.resolveTarget = nullptr;
+    colorAttachment.loadOp        = LoadOp::Clear;
+    colorAttachment.storeOp       = StoreOp::Store;
+    colorAttachment.clearValue    = WGPUColor{ 0.0, 0.0, 0.0, 1.0 };
+    RenderPassDescriptor passDesc = RenderPassDescriptor();
+    passDesc.nextInChain            = nullptr;
+    passDesc.label                  = "Post-process pass";
+    passDesc.colorAttachmentCount   = 1;
+    passDesc.colorAttachments       = &colorAttachment;
+    passDesc.depthStencilAttachment = nullptr;
+    passDesc.occlusionQuerySet      = nullptr;
+    passDesc.timestampWriteCount    = 0;
+    passDesc.timestampWrites        = nullptr;
+    return encoder.beginRenderPass(passDesc);
+}
+
+void PostProcessScene::filter(CommandEncoder encoder, const RenderTarget& source, const RenderTarget& destination) {
+    RenderPassEncoder pass = beginTargetPass(encoder, destination);
+    pass.setPipeline(m_filterPipeline);
+    pass.setBindGroup(0, sourceGroup(source), 0, nullptr);
+    pass.draw(3, 1, 0, 0);
+    pass.end();
+    pass.release();
+}
+
+void PostProcessScene::encode(CommandEncoder encoder) {
+    RenderTarget scene = m_targets->acquire(m_targetDesc, "Post-process scene");
+    RenderPassEncoder pass = beginTargetPass(encoder, scene);
+    pass.setPipeline(m_scenePipeline);
+    for (uint32_t i = 0; i < m_drawCount; i++) pass.draw(3, 1, 0, i);
+    pass.end();
+    pass.release();
+
+    RenderTarget blurred = m_targets->acquire(m_targetDesc, "Post-process blur");
+    filter(encoder, scene, blurred);
+    m_targets->release(scene);
+    m_result = m_targets->acquire(m_targetDesc, "Post-process result"); // Gets the scene's texture
+    filter(encoder, blurred, m_result);
+    m_targets->release(blurred);
+}
+
+void PostProcessScene::draw(RenderPassRecorder& renderPass) {
+    renderPass.setPipeline(m_showPipeline);
+    renderPass.setBindGroup(0, sourceGroup(m_result));
+    renderPass.draw(3);
+}
+
+UploadScene::~UploadScene() {
+    if (m_buffer) {
+        m_buffer.destroy();
+        m_buffer.release();
+    }
+}
+
+bool UploadScene::initialize(SceneResources resources) {
+    if (!TriangleScene::initialize(resources)) return false;
+    m_uploadSize = (m_uploadSize + 3) & ~3ull; // writeBuffer sizes are multiples of 4
+    BufferDescriptor bufferDesc;
+    bufferDesc.label            = "Upload target";
+    bufferDesc.size             = m_uploadSize;
+    bufferDesc.usage            = BufferUsage::CopyDst | BufferUsage::Vertex;
+    bufferDesc.mappedAtCreation = false;
+    m_buffer = resources.device.createBuffer(bufferDesc);
+    m_data.resize(m_uploadSize / sizeof(uint32_t));
+    for (size_t i = 0; i < m_data.size(); i++) m_data[i] = (uint32_t)i;
+    return m_buffer != nullptr;
+}
+
+void UploadScene::update(Queue queue, StagingBelt&, const FrameState&) {
+    m_data[0] = m_frame++; // Different contents every frame
+    queue.writeBuffer(m_buffer, 0, m_data.data(), m_uploadSize);
+}
+
+SmallUploadsScene::~SmallUploadsScene() {
+    if (m_buffer) {
+        m_buffer.destroy();
+        m_buffer.release();
+    }
+}
+
+bool SmallUploadsScene::initialize(SceneResources resources) {
+    if (!TriangleScene::initialize(resources)) return false;
+    BufferDescriptor bufferDesc;
+    bufferDesc.label            = "Small uploads target";
+    bufferDesc.size             = (uint64_t)m_uploadCount * m_uploadSize;
+    bufferDesc.usage            = BufferUsage::CopyDst | BufferUsage::Vertex;
+    bufferDesc.mappedAtCreation = false;
+    m_buffer = resources.device.createBuffer(bufferDesc);
+    m_data.resize(m_uploadSize);
+    return m_buffer != nullptr;
+}
+
+void SmallUploadsScene::update(Queue queue, StagingBelt& uploads, const FrameState&) {
+    // Every other piece, so that the writes are not one contiguous range the belt could merge
+    for (uint32_t i = 0; i < m_uploadCount; i += 2) {
+        m_data[0] = (uint8_t)i;
+        uint64_t offset = (uint64_t)i * m_uploadSize;
+        if (m_staging) {
+            uploads.writeBuffer(m_buffer, offset, m_data.data(), m_uploadSize);
+        } else {
+            queue.writeBuffer(m_buffer, offset, m_data.data(), m_uploadSize);
+        }
+    }
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "TriangleScene.h"
+#include "PipelineCache.h"
+#include "DrawQueue.h"
+#include "ParallelRecorder.h"
+#include "GpuCulling.h"
+#include "BufferAllocator.h"
+#include "RenderTargetPool.h"
+
+// Many small triangles from a single pipeline, one draw call each: measures per-draw CPU cost
+class ManyDrawsScene : public Scene {
+public:
+    explicit ManyDrawsScene(uint32_t drawCount) : m_drawCount(drawCount) {}
+    ~ManyDrawsScene() override;
+
+    const char* name() const override { return "draws"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    uint32_t m_drawCount;
+    wgpu::RenderPipeline m_pipeline = nullptr;
+};
+
+// The same draws recorded once into render bundles: measures replay cost, which should not
+// depend on the draw count
+class StaticDrawsScene : public Scene {
+public:
+    explicit StaticDrawsScene(uint32_t drawCount) : m_drawCount(drawCount) {}
+    ~StaticDrawsScene() override;
+
+    const char* name() const override { return "static"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder&) override {}
+
+private:
+    uint32_t m_drawCount;
+    wgpu::RenderPipeline m_pipeline = nullptr;
+};
+
+// One draw per pipeline, each from its own shader module: measures pipeline switch cost
+class ManyPipelinesScene : public Scene {
+public:
+    explicit ManyPipelinesScene(uint32_t pipelineCount) : m_pipelineCount(pipelineCount) {}
+    ~ManyPipelinesScene() override;
+
+    const char* name() const override { return "pipelines"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    uint32_t m_pipelineCount;
+    std::vector<wgpu::RenderPipeline> m_pipelines;
+};
+
+// The same draws with pipelines looked up in a PipelineCache every draw, compiled in the
+// background: measures lookup cost, and the first frames run with the fallback
+class CachedPipelinesScene : public Scene {
+public:
+    CachedPipelinesScene(uint32_t pipelineCount, PipelineCache::Fallback fallback) : m_pipelineCount(pipelineCount), m_fallback(fallback) {}
+    ~CachedPipelinesScene() override;
+
+    const char* name() const override { return "pipelines-async"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    uint32_t m_pipelineCount;
+    PipelineCache::Fallback m_fallback;
+    std::unique_ptr<PipelineCache> m_cache;
+    std::vector<std::unique_ptr<BasicPipelineDescriptor>> m_descriptors;
+    wgpu::RenderPipeline m_standIn = nullptr;
+};
+
+// Draws spread over many pipelines, submitted in scrambled order through a DrawQueue and
+// replayed sorted by key or as submitted: measures sort cost against pipeline switch cost
+class SortedDrawsScene : public Scene {
+public:
+    SortedDrawsScene(uint32_t drawCount, uint32_t pipelineCount, bool sort)
+        : m_drawCount(drawCount), m_pipelineCount(pipelineCount), m_sort(sort) {}
+    ~SortedDrawsScene() override;
+
+    const char* name() const override { return m_sort ? "sorted" : "unsorted"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+protected:
+    void submitDraws();
+
+    uint32_t m_drawCount;
+    uint32_t m_pipelineCount;
+    bool m_sort;
+    std::vector<wgpu::RenderPipeline> m_pipelines;
+    DrawQueue m_queue;
+};
+
+// The sorted draws recorded into one render bundle per thread: measures how encoding scales
+class ParallelDrawsScene : public SortedDrawsScene {
+public:
+    ParallelDrawsScene(uint32_t drawCount, uint32_t pipelineCount, uint32_t minDrawsPerBundle)
+        : SortedDrawsScene(drawCount, pipelineCount, true), m_minDrawsPerBundle(minDrawsPerBundle) {}
+
+    const char* name() const override { return "parallel"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    uint32_t m_minDrawsPerBundle;
+    std::unique_ptr<ParallelRecorder> m_recorder;
+    std::vector<const DrawQueue::Draw*> m_draws;
+};
+
+// Objects on a grid twice as wide as the view, which pans over it, frustum culled in a compute
+// pass and drawn with one multi-draw call: CPU cost should not depend on the draw count
+class CulledDrawsScene : public Scene {
+public:
+    explicit CulledDrawsScene(uint32_t drawCount) : m_drawCount(drawCount) {}
+    ~CulledDrawsScene() override;
+
+    const char* name() const override { return "culled"; }
+    bool initialize(SceneResources resources) override;
+    void update(wgpu::Queue queue, StagingBelt& uploads, const FrameState& state) override;
+    void encode(wgpu::CommandEncoder encoder) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    uint32_t m_drawCount;
+    std::unique_ptr<GpuCulling> m_culling;
+    wgpu::RenderPipeline m_pipeline = nullptr;
+    wgpu::BindGroup m_bindGroup = nullptr;
+    wgpu::Buffer m_camera = nullptr;
+    wgpu::Buffer m_indices = nullptr;
+};
+
+// One uniform buffer range per triangle from a BufferAllocator with small pages, a sixteenth of
+// them reallocated every frame with sizes that slowly grow and shrink, and the allocator
+// defragmented every frame. Each draw gets its bind group from the BindGroupCache, which the
+// allocator invalidates when it destroys a page: measures allocation, defragmentation and
+// bind group lookup cost
+class AllocatorScene : public Scene {
+public:
+    explicit AllocatorScene(uint32_t drawCount) : m_drawCount(drawCount) {}
+    ~AllocatorScene() override;
+
+    const char* name() const override { return "allocator"; }
+    bool initialize(SceneResources resources) override;
+    void update(wgpu::Queue queue, StagingBelt& uploads, const FrameState& state) override;
+    void encode(wgpu::CommandEncoder encoder) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    void allocate(wgpu::Queue queue, uint32_t triangle);
+
+    uint32_t m_drawCount;
+    uint32_t m_frame = 0;
+    uint32_t m_next = 0; // Next triangle to reallocate
+    BindGroupCache* m_bindGroups = nullptr;
+    std::unique_ptr<BufferAllocator> m_allocator;
+    std::vector<BufferAllocation> m_triangles;
+    wgpu::RenderPipeline m_pipeline = nullptr;
+    wgpu::BindGroupLayout m_layout = nullptr;
+};
+
+// 64 draws over every variant of a WGSL shader with three features and of a GLSL vertex and
+// fragment shader pair with one and two, from the ShaderPermutations and the PipelineCache.
+// Draws skip until their variant and pipeline are compiled: measures variant lookup cost and,
+// in the first frames, background compilation
+class PermutationsScene : public Scene {
+public:
+    const char* name() const override { return "permutations"; }
+    bool initialize(SceneResources resources) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    static const uint32_t VariantCount = 8; // Of each shader kind
+    const BasicPipelineDescriptor* descriptor(uint32_t cell); // Null until the modules are ready
+
+    ShaderPermutations* m_permutations = nullptr;
+    PipelineCache* m_pipelines = nullptr;
+    wgpu::TextureFormat m_targetFormat = wgpu::TextureFormat::Undefined;
+    uint32_t m_wgsl = 0;
+    uint32_t m_vertex = 0;
+    uint32_t m_fragment = 0;
+    std::vector<std::unique_ptr<BasicPipelineDescriptor>> m_descriptors; // WGSL variants, then GLSL pairs
+};
+
+// A post-processing chain every frame: the grid of triangles rendered into a pooled target,
+// filtered into a second one and back into a third of the same key, which the main pass
+// shows. The first is released before the third is acquired, so the two share a texture and
+// each frame in flight needs two textures for three targets: measures the chain's cost
+class PostProcessScene : public Scene {
+public:
+    explicit PostProcessScene(uint32_t drawCount) : m_drawCount(drawCount) {}
+    ~PostProcessScene() override;
+
+    const char* name() const override { return "postprocess"; }
+    bool initialize(SceneResources resources) override;
+    void encode(wgpu::CommandEncoder encoder) override;
+    void draw(RenderPassRecorder& renderPass) override;
+
+private:
+    void filter(wgpu::CommandEncoder encoder, const RenderTarget& source, const RenderTarget& destination);
+    wgpu::BindGroup sourceGroup(const RenderTarget& source);
+
+    uint32_t m_drawCount;
+    RenderTargetPool* m_targets = nullptr;
+    BindGroupCache* m_bindGroups = nullptr;
+    RenderTargetDesc m_targetDesc;
+    RenderTarget m_result; // Drawn by the main pass, released by the pool at the end of the frame
+    wgpu::RenderPipeline m_scenePipeline = nullptr;
+    wgpu::RenderPipeline m_filterPipeline = nullptr; // Into the pooled targets
+    wgpu::RenderPipeline m_showPipeline = nullptr; // Into the main pass
+    wgpu::BindGroupLayout m_layout = nullptr;
+};
+
+// The triangle plus a large Queue::writeBuffer every frame: measures upload bandwidth
+class UploadScene : public TriangleScene {
+public:
+    explicit UploadScene(uint64_t uploadSize) : m_uploadSize(uploadSize) {}
+    ~UploadScene() override;
+
+    const char* name() const override { return "upload"; }
+    bool initialize(SceneResources resources) override;
+    void update(wgpu::Queue queue, StagingBelt& uploads, const FrameState& state) override;
+
+private:
+    uint64_t m_uploadSize;
+    wgpu::Buffer m_buffer = nullptr;
+    std::vector<uint32_t> m_data;
+    uint32_t m_frame = 0;
+};
+
+// The triangle plus many small uploads every frame, one Queue::writeBuffer each or batched
+// through the staging belt: measures per-upload overhead
+class SmallUploadsScene : public TriangleScene {
+public:
+    SmallUploadsScene(uint32_t uploadCount, uint32_t uploadSize, bool staging)
+        : m_uploadCount(uploadCount), m_uploadSize((uploadSize + 3) & ~3u), m_staging(staging) {}
+    ~SmallUploadsScene() override;
+
+    const char* name() const override { return m_staging ? "belt" : "writes"; }
+    bool initialize(SceneResources resources) override;
+    void update(wgpu::Queue queue, StagingBelt& uploads, const FrameState& state) override;
+
+private:
+    uint32_t m_uploadCount;
+    uint32_t m_uploadSize;
+    bool m_staging;
+    wgpu::Buffer m_buffer = nullptr;
+    std::vector<uint8_t> m_data;
+};
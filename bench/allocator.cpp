@@ -0,0 +1,142 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "Tlsf.h"
+#include "Clock.h"
+
+// Cost and correctness of the TLSF allocator behind BufferAllocator, without a device:
+//  - churn: random frees and allocations of 256 B to 64 KiB around a steady live count,
+//    checking every region's block list at intervals
+//  - drain: freeing everything must coalesce each region back into a single free block
+//  - evacuate: with a region disabled, as defragment() does, no allocation may land in it
+// Exits with 1 when a check fails. BufferAllocator::defragment() itself needs a device, the
+// "allocator" scene of WebGPU_Bench runs it.
+
+// Blocks tile each live region in address order, free neighbours are always merged and the
+// allocated sizes add up. Returns the first problem found, null when there is none.
+static const char* checkRegions(const Tlsf& tlsf) {
+    for (uint32_t region = 0; region < tlsf.regionCount(); region++) {
+        if (tlsf.regionRemoved(region)) continue;
+        uint64_t offset = 0;
+        uint64_t allocated = 0;
+        bool previousFree = false;
+        for (uint32_t block = tlsf.firstBlock(region); block != Tlsf::kInvalid; block = tlsf.nextBlock(block)) {
+            if (tlsf.region(block) != region) return "block in the wrong region";
+            if (tlsf.offset(block) != offset) return "gap or overlap between blocks";
+            if (tlsf.isFree(block) && previousFree) return "adjacent free blocks were not merged";
+            if (!tlsf.isFree(block)) allocated += tlsf.size(block);
+            previousFree = tlsf.isFree(block);
+            offset += tlsf.size(block);
+        }
+        if (offset != tlsf.regionSize(region)) return "blocks do not cover the region";
+        if (allocated != tlsf.regionAllocated(region)) return "allocated size out of sync";
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    uint32_t liveCount = 10000;
+    uint32_t operationCount = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--allocations") == 0 && i + 1 < argc) liveCount = (uint32_t)std::max(1, atoi(argv[++i]));
+        if (strcmp(argv[i], "--operations") == 0 && i + 1 < argc) operationCount = (uint32_t)std::max(1, atoi(argv[++i]));
+    }
+    Clock::useGlfw(false);
+
+    const uint64_t granularity = 256;
+    const uint64_t regionSize = 64ull << 20;
+    Tlsf tlsf(granularity);
+    std::mt19937 random(1234); // Same sequence every run
+    std::uniform_real_distribution<double> logSize(8.0, 16.0); // 256 B to 64 KiB, log-uniform
+    auto randomSize = [&]() { return (uint64_t)std::exp2(logSize(random)); };
+    auto allocate = [&](uint64_t size) {
+        uint32_t block = tlsf.allocate(size);
+        if (block == Tlsf::kInvalid) {
+            tlsf.addRegion(std::max(regionSize, tlsf.regionSizeFor(size)));
+            block = tlsf.allocate(size);
+        }
+        return block;
+    };
+
+    bool ok = true;
+    auto check = [&](const char* phase) {
+        const char* problem = checkRegions(tlsf);
+        if (!problem) return true;
+        std::cerr << phase << ": " << problem << std::endl;
+        ok = false;
+        return false;
+    };
+
+    std::vector<uint32_t> live;
+    live.reserve(2 * liveCount);
+    for (uint32_t i = 0; i < liveCount; i++) live.push_back(allocate(randomSize()));
+
+    // Alternate frees and allocations, biased towards the target live count
+    uint64_t checkTicks = 0;
+    uint64_t start = Clock::ticks();
+    for (uint32_t i = 0; i < operationCount && ok; i++) {
+        bool freeOne = !live.empty() && (live.size() > liveCount ? random() % 4 != 0 : random() % 4 == 0);
+        if (freeOne) {
+            size_t index = random() % live.size();
+            tlsf.free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        } else {
+            uint32_t block = allocate(randomSize());
+            if (block == Tlsf::kInvalid) {
+                std::cerr << "churn: allocation failed with a fresh region" << std::endl;
+                ok = false;
+                break;
+            }
+            live.push_back(block);
+        }
+        if (i % 10000 == 9999) {
+            uint64_t checkStart = Clock::ticks();
+            check("churn");
+            checkTicks += Clock::ticks() - checkStart;
+        }
+    }
+    double churnSeconds = (double)(Clock::ticks() - start - checkTicks) / (double)Clock::frequency();
+    Tlsf::Stats churnStats = tlsf.stats();
+
+    // Drain
+    for (uint32_t block : live) tlsf.free(block);
+    live.clear();
+    check("drain");
+    Tlsf::Stats drained = tlsf.stats();
+    if (ok && (drained.allocated != 0 || drained.allocations != 0 || drained.freeBlocks != tlsf.regionCount())) {
+        std::cerr << "drain: " << drained.freeBlocks << " free blocks in " << tlsf.regionCount() << " regions" << std::endl;
+        ok = false;
+    }
+
+    // Evacuate: fill part of every region, disable the first one and allocate elsewhere
+    for (uint32_t i = 0; i < liveCount; i++) live.push_back(allocate(randomSize()));
+    tlsf.setRegionEnabled(0, false);
+    for (uint32_t i = 0; i < liveCount && ok; i++) {
+        uint32_t block = allocate(randomSize());
+        if (block == Tlsf::kInvalid || tlsf.region(block) == 0) {
+            std::cerr << "evacuate: allocation in a disabled region" << std::endl;
+            ok = false;
+        }
+        live.push_back(block);
+    }
+    tlsf.setRegionEnabled(0, true);
+    for (uint32_t block : live) {
+        if (block != Tlsf::kInvalid) tlsf.free(block);
+    }
+    check("evacuate");
+
+    std::cout << operationCount << " operations around " << liveCount << " live allocations" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "churn      " << 1e9 * churnSeconds / operationCount << " ns/op, " << churnStats.allocations << " live, "
+              << churnStats.freeBlocks << " free blocks, " << std::setprecision(3) << churnStats.fragmentation() << " fragmentation, "
+              << tlsf.regionCount() << " regions" << std::endl;
+    std::cout << std::defaultfloat;
+    std::cout << (ok ? "All checks passed" : "Checks failed") << std::endl;
+    return ok ? 0 : 1;
+}
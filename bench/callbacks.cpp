@@ -0,0 +1,141 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <webgpu/webgpu.hpp>
+#include "Clock.h"
+
+using namespace wgpu;
+
+// Counts every C++ heap allocation. wgpu-native allocates from Rust, so this only sees the
+// C++ wrapper's own allocations, which is what is being measured.
+static size_t s_allocations = 0;
+
+void* operator new(size_t size) {
+    s_allocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Compares the std::function overloads of the async calls (one heap allocation for the
+// handle, one more for captures that do not fit std::function's small buffer) with the
+// templated allocation-free ones, on a captured state typical of the renderer's callbacks.
+struct Result {
+    double allocationsPerCall;
+    double nanosecondsPerCall;
+};
+
+template <typename Body>
+Result measure(uint32_t iterations, Body body) {
+    size_t allocations = s_allocations;
+    uint64_t start = Clock::ticks();
+    for (uint32_t i = 0; i < iterations; i++) body();
+    uint64_t ticks = Clock::ticks() - start;
+    Result result;
+    result.allocationsPerCall = (double)(s_allocations - allocations) / iterations;
+    result.nanosecondsPerCall = 1e9 * (double)ticks / (double)Clock::frequency() / iterations;
+    return result;
+}
+
+void report(const char* name, const Result& before, const Result& after) {
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << before.allocationsPerCall << std::setw(10) << after.allocationsPerCall
+              << std::setw(12) << before.nanosecondsPerCall << std::setw(12) << after.nanosecondsPerCall << std::endl;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = 10000;
+    bool forceFallbackAdapter = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = (uint32_t)std::max(1, atoi(argv[++i]));
+        if (strcmp(argv[i], "--cpu") == 0) forceFallbackAdapter = true;
+    }
+    Clock::useGlfw(false);
+
+    InstanceDescriptor desc = {};
+    desc.nextInChain = nullptr;
+    Instance instance = createInstance(desc);
+    RequestAdapterOptions adapterOpts = {};
+    adapterOpts.nextInChain          = nullptr;
+    adapterOpts.compatibleSurface    = nullptr;
+    adapterOpts.forceFallbackAdapter = forceFallbackAdapter;
+    Adapter adapter = instance ? instance.requestAdapter(adapterOpts) : nullptr;
+    DeviceDescriptor deviceDesc = {};
+    deviceDesc.nextInChain              = nullptr;
+    deviceDesc.label                    = "Device";
+    deviceDesc.requiredFeaturesCount    = 0;
+    deviceDesc.requiredLimits           = nullptr;
+    deviceDesc.defaultQueue.nextInChain = nullptr;
+    deviceDesc.defaultQueue.label       = "Default Queue";
+    Device device = adapter ? adapter.requestDevice(deviceDesc) : nullptr;
+    if (!device) {
+        std::cerr << "Could not initialize WebGPU!" << std::endl;
+        return 1;
+    }
+    Queue queue = device.getQueue();
+
+    BufferDescriptor bufferDesc;
+    bufferDesc.label            = "Readback";
+    bufferDesc.size             = 256;
+    bufferDesc.usage            = BufferUsage::MapRead | BufferUsage::CopyDst;
+    bufferDesc.mappedAtCreation = false;
+    Buffer buffer = device.createBuffer(bufferDesc);
+
+    // Three pointers: more than std::function stores inline, well within one pool block
+    int completed = 0;
+    int* counter = &completed;
+    Buffer* target = &buffer;
+    Device* owner = &device;
+
+    std::cout << "Per call over " << iterations << " iterations           allocs before/after   ns before/after" << std::endl;
+
+    Result before = measure(iterations, [&]() {
+        auto handle = buffer.mapAsync(MapMode::Read, 0, 256, BufferMapCallback([counter, target, owner](BufferMapAsyncStatus) { (*counter)++; (void)target; (void)owner; }));
+        device.poll(true, nullptr);
+        buffer.unmap();
+    });
+    Result after = measure(iterations, [&]() {
+        buffer.mapAsync(MapMode::Read, 0, 256, [counter, target, owner](BufferMapAsyncStatus) { (*counter)++; (void)target; (void)owner; });
+        device.poll(true, nullptr);
+        buffer.unmap();
+    });
+    report("Buffer::mapAsync", before, after);
+
+    before = measure(iterations, [&]() {
+        device.pushErrorScope(ErrorFilter::Validation);
+        auto handle = device.popErrorScope(ErrorCallback([counter, target, owner](ErrorType, char const *) { (*counter)++; (void)target; (void)owner; }));
+        device.poll(true, nullptr);
+    });
+    after = measure(iterations, [&]() {
+        device.pushErrorScope(ErrorFilter::Validation);
+        device.popErrorScope([counter, target, owner](ErrorType, char const *) { (*counter)++; (void)target; (void)owner; });
+        device.poll(true, nullptr);
+    });
+    report("Device::popErrorScope", before, after);
+
+    before = measure(iterations, [&]() {
+        queue.submit(0, nullptr);
+        auto handle = queue.onSubmittedWorkDone(QueueWorkDoneCallback([counter, target, owner](QueueWorkDoneStatus) { (*counter)++; (void)target; (void)owner; }));
+        device.poll(true, nullptr);
+    });
+    after = measure(iterations, [&]() {
+        queue.submit(0, nullptr);
+        queue.onSubmittedWorkDone([counter, target, owner](QueueWorkDoneStatus) { (*counter)++; (void)target; (void)owner; });
+        device.poll(true, nullptr);
+    });
+    report("Queue::onSubmittedWorkDone", before, after);
+
+    std::cout << completed << " callbacks ran, " << 6 * iterations << " expected" << std::endl;
+
+    buffer.destroy();
+    buffer.release();
+    queue.release();
+    device.release();
+    adapter.release();
+    instance.release();
+    return completed == (int)(6 * iterations) ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include "JobSystem.h"
+#include "Clock.h"
+
+// Task overhead of the job system at 1 to 64 threads:
+//  - spawn: the main thread runs batches of empty jobs and waits, idle threads steal them
+//  - fork: each job splits its range in two child jobs down to single items, so that most
+//    jobs are pushed and popped by the same thread and only whole subtrees are stolen
+//  - work: ~1 us jobs, the throughput speedup shows how well the pool scales
+struct Result {
+    double nanosecondsPerJob;
+    double stolenPercent;
+};
+
+template <typename Body>
+Result measure(JobSystem& jobs, uint32_t jobCount, Body body) {
+    JobSystem::Stats before = jobs.stats();
+    uint64_t start = Clock::ticks();
+    body();
+    uint64_t ticks = Clock::ticks() - start;
+    JobSystem::Stats after = jobs.stats();
+    Result result;
+    result.nanosecondsPerJob = 1e9 * (double)ticks / (double)Clock::frequency() / jobCount;
+    uint64_t executed = after.executed - before.executed;
+    result.stolenPercent = executed ? 100.0 * (double)(after.stolen - before.stolen) / (double)executed : 0.0;
+    return result;
+}
+
+static void fork(JobSystem& jobs, uint32_t first, uint32_t last, std::atomic<uint32_t>& done) {
+    if (last - first == 1) {
+        done.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t middle = first + (last - first) / 2;
+    JobCounter children;
+    jobs.run([&jobs, first, middle, &done]() { fork(jobs, first, middle, done); }, &children);
+    jobs.run([&jobs, middle, last, &done]() { fork(jobs, middle, last, done); }, &children);
+    jobs.wait(children);
+}
+
+static void spin(uint32_t iterations) {
+    volatile uint32_t sink = 0;
+    for (uint32_t i = 0; i < iterations; i++) sink = sink + i;
+}
+
+int main(int argc, char** argv) {
+    uint32_t jobCount = 100000;
+    uint32_t maxThreads = 64;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobCount = (uint32_t)std::max(1, atoi(argv[++i]));
+        if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) maxThreads = (uint32_t)std::max(1, atoi(argv[++i]));
+    }
+    Clock::useGlfw(false);
+
+    // Calibrate the work jobs to about a microsecond, after warming up the core
+    const uint32_t calibrationIterations = 10000000;
+    spin(calibrationIterations);
+    uint64_t start = Clock::ticks();
+    spin(calibrationIterations);
+    double spinSeconds = (double)(Clock::ticks() - start) / (double)Clock::frequency();
+    uint32_t spinIterations = std::max(1u, (uint32_t)(calibrationIterations * 1e-6 / std::max(spinSeconds, 1e-9)));
+
+    std::cout << jobCount << " jobs, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << "threads   spawn ns/job  stolen%    fork ns/job  stolen%    work speedup" << std::endl;
+    double workBaseline = 0.0;
+    bool ok = true;
+    for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+        JobSystem jobs(threads);
+        std::atomic<uint32_t> done{ 0 };
+
+        const uint32_t batch = JobSystem::MaxJobsPerThread / 2; // The main thread's ring never fills up
+        Result spawn = measure(jobs, jobCount, [&]() {
+            for (uint32_t first = 0; first < jobCount; first += batch) {
+                JobCounter counter;
+                uint32_t count = std::min(batch, jobCount - first);
+                for (uint32_t i = 0; i < count; i++) jobs.run([&done]() { done.fetch_add(1, std::memory_order_relaxed); }, &counter);
+                jobs.wait(counter);
+            }
+        });
+        Result forkJoin = measure(jobs, 2 * jobCount, [&]() { fork(jobs, 0, jobCount, done); }); // About twice as many jobs as leaves
+        Result work = measure(jobs, jobCount, [&]() {
+            jobs.parallelFor(jobCount, 16, [spinIterations, &done](uint32_t) {
+                spin(spinIterations);
+                done.fetch_add(1, std::memory_order_relaxed);
+            });
+        });
+        if (threads == 1) workBaseline = work.nanosecondsPerJob;
+        ok &= done.load() == 3 * jobCount;
+
+        std::cout << std::setw(7) << threads << std::fixed << std::setprecision(1)
+                  << std::setw(15) << spawn.nanosecondsPerJob << std::setw(9) << spawn.stolenPercent
+                  << std::setw(15) << forkJoin.nanosecondsPerJob << std::setw(9) << forkJoin.stolenPercent
+                  << std::setw(15) << std::setprecision(2) << workBaseline / work.nanosecondsPerJob << "x" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+    if (!ok) std::cerr << "Some jobs did not run" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <algorithm>
+#include <GLFW/glfw3.h>
+#include <webgpu/webgpu.hpp>
+#include <glfw3webgpu.h>
+#include "Renderer.h"
+#include "FrameProfiler.h"
+#include "TriangleScene.h"
+#include "Clock.h"
+#include "BenchScenes.h"
+#include "JobSystem.h"
+#include "BindGroupCache.h"
+#include "RenderTargetPool.h"
+
+using namespace wgpu;
+
+// Renders fixed scenes for a fixed number of frames and reports the frame profiler's scopes as
+// JSON, so that CI can gate on regressions. Headless by default; --window presents to a
+// window so that present time is meaningful.
+struct BenchOptions {
+    uint32_t warmupFrames = 100;
+    uint32_t frames = 500;
+    int width = 1280;
+    int height = 720;
+    bool window = false;
+    bool forceFallbackAdapter = false;
+    std::string scene = "all"; // triangle|draws|static|pipelines|pipelines-async|sorted|unsorted|parallel|culled|allocator|postprocess|permutations|upload|writes|belt|all
+    uint32_t drawCount = 10000;
+    uint32_t pipelineCount = 256;
+    uint32_t threadCount = 0; // All hardware threads
+    uint32_t bundleDraws = 512; // Minimum draws per bundle of the parallel scene
+    PipelineCache::Fallback fallback = PipelineCache::Fallback::Skip;
+    uint32_t uploadMegabytes = 16;
+    uint32_t smallUploadCount = 4096;
+    std::string outputPath = "bench.json";
+};
+
+struct SceneResult {
+    std::string name;
+    bool ok = false;
+    const char* missingFeature = nullptr; // Skipped rather than failed when set
+    double seconds = 0.0;
+    std::vector<std::pair<const char*, FrameProfiler::Stats>> cpu;
+    FrameProfiler::Stats gpu;
+    RenderPassRecorder::Stats pass;
+    BindGroupCache::Stats bindGroups; // Over the measured frames, but for live
+    RenderTargetPool::Stats targets; // Since the scene started
+};
+
+BenchOptions parseOptions(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        if (strcmp(argv[i], "--warmup") == 0) {
+            options.warmupFrames = (uint32_t)std::max(0, atoi(value));
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            options.frames = (uint32_t)std::max(1, atoi(value));
+        } else if (strcmp(argv[i], "--size") == 0) { // <width>x<height>
+            if (sscanf(value, "%dx%d", &options.width, &options.height) != 2) std::cerr << "Expected --size <width>x<height>" << std::endl;
+        } else if (strcmp(argv[i], "--scene") == 0) {
+            options.scene = value;
+        } else if (strcmp(argv[i], "--draws") == 0) {
+            options.drawCount = (uint32_t)std::max(1, atoi(value));
+        } else if (strcmp(argv[i], "--pipelines") == 0) {
+            options.pipelineCount = (uint32_t)std::max(1, atoi(value));
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            options.threadCount = (uint32_t)std::max(0, atoi(value));
+        } else if (strcmp(argv[i], "--bundle-draws") == 0) {
+            options.bundleDraws = (uint32_t)std::max(1, atoi(value));
+        } else if (strcmp(argv[i], "--fallback") == 0) { // skip|standin
+            options.fallback = strcmp(value, "standin") == 0 ? PipelineCache::Fallback::StandIn : PipelineCache::Fallback::Skip;
+        } else if (strcmp(argv[i], "--upload-mb") == 0) {
+            options.uploadMegabytes = (uint32_t)std::max(1, atoi(value));
+        } else if (strcmp(argv[i], "--small-uploads") == 0) {
+            options.smallUploadCount = (uint32_t)std::max(2, atoi(value));
+        } else if (strcmp(argv[i], "--out") == 0) {
+            options.outputPath = value;
+        } else if (strcmp(argv[i], "--window") == 0) {
+            options.window = true;
+        } else if (strcmp(argv[i], "--cpu") == 0) {
+            options.forceFallbackAdapter = true;
+        }
+    }
+    return options;
+}
+
+std::unique_ptr<Scene> createScene(const std::string& name, const BenchOptions& options) {
+    if (name == "triangle") return std::make_unique<TriangleScene>();
+    if (name == "draws") return std::make_unique<ManyDrawsScene>(options.drawCount);
+    if (name == "static") return std::make_unique<StaticDrawsScene>(options.drawCount);
+    if (name == "pipelines") return std::make_unique<ManyPipelinesScene>(options.pipelineCount);
+    if (name == "pipelines-async") return std::make_unique<CachedPipelinesScene>(options.pipelineCount, options.fallback);
+    if (name == "sorted") return std::make_unique<SortedDrawsScene>(options.drawCount, options.pipelineCount, true);
+    if (name == "unsorted") return std::make_unique<SortedDrawsScene>(options.drawCount, options.pipelineCount, false);
+    if (name == "parallel") return std::make_unique<ParallelDrawsScene>(options.drawCount, options.pipelineCount, options.bundleDraws);
+    if (name == "culled") return std::make_unique<CulledDrawsScene>(options.drawCount);
+    if (name == "allocator") return std::make_unique<AllocatorScene>(options.drawCount);
+    if (name == "postprocess") return std::make_unique<PostProcessScene>(options.drawCount);
+    if (name == "permutations") return std::make_unique<PermutationsScene>();
+    if (name == "upload") return std::make_unique<UploadScene>((uint64_t)options.uploadMegabytes << 20);
+    if (name == "writes") return std::make_unique<SmallUploadsScene>(options.smallUploadCount, 64, false);
+    if (name == "belt") return std::make_unique<SmallUploadsScene>(options.smallUploadCount, 64, true);
+    return nullptr;
+}
+
+// Device feature a scene needs that the adapter lacks, null when the scene can run
+const char* missingFeature(const std::string& name, Device device) {
+    if (name == "culled" && !GpuCulling::supported(device)) return "IndirectFirstInstance";
+    return nullptr;
+}
+
+SceneResult runScene(Instance instance, Surface surface, GLFWwindow* window, const std::string& name, const BenchOptions& options) {
+    SceneResult result;
+    result.name = name;
+
+    RendererConfig config;
+    config.width                = options.width;
+    config.height               = options.height;
+    config.pacing               = PacingPolicy::LowestLatency; // Never wait for vsync
+    config.forceFallbackAdapter = options.forceFallbackAdapter;
+    config.profileHistory       = options.frames;
+    config.shaderCacheDirectory = ""; // Every scene starts cold, whatever earlier runs left behind
+    JobSystem jobs(options.threadCount);
+    config.jobs                 = &jobs;
+    Renderer renderer;
+    std::unique_ptr<Scene> scene = createScene(name, options);
+    if (!scene) {
+        std::cerr << "Unknown scene '" << name << "'" << std::endl;
+        return result;
+    }
+    if (!renderer.initialize(instance, surface, config)) return result;
+    result.missingFeature = missingFeature(name, renderer.device());
+    if (result.missingFeature || !renderer.setScene(std::move(scene))) return result;
+
+    // Frames are a pure function of their index, so every run renders the same thing
+    FrameState frame;
+    uint32_t frameIndex = 0;
+    auto render = [&](uint32_t count) {
+        for (uint32_t i = 0; i < count; i++, frameIndex++) {
+            if (window) glfwPollEvents();
+            frame.pulseTime = frameIndex / 60.0;
+            renderer.renderFrame(frame);
+        }
+    };
+
+    render(options.warmupFrames);
+    FrameProfiler& profiler = *renderer.profiler();
+    profiler.reset();
+    renderer.resetPassStats();
+    BindGroupCache::Stats bindGroups = renderer.bindGroups()->stats();
+    double start = Clock::seconds();
+    render(options.frames);
+    renderer.waitIdle();
+    result.seconds = Clock::seconds() - start;
+    profiler.flush();
+
+    for (const char* scope : { "Frame", "Update", "Encode", "Submit", "Present" }) {
+        result.cpu.emplace_back(scope, profiler.cpuStats(scope));
+    }
+    result.gpu = profiler.gpuStats("Main pass");
+    result.pass = renderer.passStats();
+    result.bindGroups = renderer.bindGroups()->stats();
+    result.bindGroups.hits    -= bindGroups.hits;
+    result.bindGroups.created -= bindGroups.created;
+    result.bindGroups.evicted -= bindGroups.evicted;
+    result.targets = renderer.renderTargets()->stats();
+    result.ok = true;
+    renderer.terminate();
+    return result;
+}
+
+void writeStats(std::ostream& out, const FrameProfiler::Stats& stats) {
+    if (stats.samples == 0) {
+        out << "null";
+        return;
+    }
+    out << "{\"samples\":" << stats.samples << ",\"min\":" << stats.min << ",\"mean\":" << stats.mean
+        << ",\"p50\":" << stats.p50 << ",\"p99\":" << stats.p99 << "}";
+}
+
+bool writeJson(const char* path, const BenchOptions& options, const std::vector<SceneResult>& results) {
+    std::ofstream file(path);
+    if (!file) return false;
+    file << std::fixed << std::setprecision(4);
+    file << "{\n  \"config\": {\"width\":" << options.width << ",\"height\":" << options.height
+         << ",\"warmupFrames\":" << options.warmupFrames << ",\"frames\":" << options.frames
+         << ",\"mode\":\"" << (options.window ? "window" : "headless") << "\""
+         << ",\"fallbackAdapter\":" << (options.forceFallbackAdapter ? "true" : "false")
+         << ",\"draws\":" << options.drawCount << ",\"pipelines\":" << options.pipelineCount << ",\"threads\":" << options.threadCount
+         << ",\"bundleDraws\":" << options.bundleDraws
+         << ",\"uploadMegabytes\":" << options.uploadMegabytes << ",\"smallUploads\":" << options.smallUploadCount << "},\n";
+    file << "  \"unit\": \"ms\",\n  \"scenes\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const SceneResult& result = results[i];
+        file << (i ? "," : "") << "\n    {\"name\":\"" << result.name << "\",\"ok\":" << (result.ok ? "true" : "false");
+        if (result.missingFeature) file << ",\"skipped\":\"missing " << result.missingFeature << "\"";
+        if (result.ok) {
+            file << ",\"seconds\":" << result.seconds << ",\"fps\":" << options.frames / result.seconds << ",\"cpu\":{";
+            for (size_t j = 0; j < result.cpu.size(); j++) {
+                std::string key = result.cpu[j].first;
+                for (char& c : key) c = (char)tolower(c);
+                file << (j ? "," : "") << "\"" << key << "\":";
+                writeStats(file, result.cpu[j].second);
+            }
+            file << "},\"gpu\":{\"main_pass\":";
+            writeStats(file, result.gpu);
+            file << "},\"state\":{\"draws\":" << result.pass.draws << ",\"forwarded\":" << result.pass.forwarded
+                 << ",\"filtered\":" << result.pass.filtered() << "}";
+            const BindGroupCache::Stats& groups = result.bindGroups;
+            file << ",\"bindGroups\":{\"hits\":" << groups.hits << ",\"created\":" << groups.created
+                 << ",\"evicted\":" << groups.evicted << ",\"live\":" << groups.live << "}";
+            file << ",\"renderTargets\":{\"created\":" << result.targets.created << ",\"textures\":" << result.targets.textures
+                 << ",\"aliased\":" << result.targets.aliased << "}";
+        }
+        file << "}";
+    }
+    file << "\n  ]\n}\n";
+    return (bool)file;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = parseOptions(argc, argv);
+    Clock::useGlfw(false); // Same timer with and without a window
+
+    GLFWwindow* window = nullptr;
+    if (options.window) {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW" << std::endl;
+            return 1;
+        }
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // Fixed size, for comparable runs
+        window = glfwCreateWindow(options.width, options.height, "WebGPU Bench", NULL, NULL);
+        if (!window) {
+            std::cerr << "Failed to create window" << std::endl;
+            glfwTerminate();
+            return 1;
+        }
+        glfwGetFramebufferSize(window, &options.width, &options.height);
+    }
+
+    InstanceDescriptor desc = {};
+    desc.nextInChain = nullptr;
+    Instance instance = createInstance(desc);
+    if (!instance) {
+        std::cerr << "Could not initialize WebGPU!" << std::endl;
+        return 1;
+    }
+    Surface surface = window ? glfwGetWGPUSurface(instance, window) : nullptr;
+
+    std::vector<std::string> scenes = { options.scene };
+    if (options.scene == "all") scenes = { "triangle", "draws", "static", "pipelines", "pipelines-async", "sorted", "unsorted", "parallel", "culled", "allocator", "postprocess", "permutations", "upload", "writes", "belt" };
+
+    std::vector<SceneResult> results;
+    bool ok = true;
+    for (const std::string& name : scenes) {
+        results.push_back(runScene(instance, surface, window, name, options));
+        const SceneResult& result = results.back();
+        if (result.missingFeature) {
+            std::cout << "Scene '" << name << "' skipped, the device lacks " << result.missingFeature << std::endl;
+            continue;
+        }
+        ok &= result.ok;
+        if (!result.ok) {
+            std::cerr << "Scene '" << name << "' failed" << std::endl;
+            continue;
+        }
+        std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+                  << options.frames / result.seconds << " fps";
+        for (const auto& [scope, stats] : result.cpu) std::cout << "  " << scope << " " << stats.p50;
+        if (result.gpu.samples > 0) std::cout << "  GPU " << result.gpu.p50;
+        std::cout << " (p50 ms)" << std::defaultfloat;
+        if (result.bindGroups.hits + result.bindGroups.created > 0) {
+            std::cout << "  bind groups " << result.bindGroups.hits << " hits " << result.bindGroups.created << " created";
+        }
+        if (result.targets.created > 0) {
+            std::cout << "  render targets " << result.targets.created << " created " << result.targets.textures << " textures "
+                      << result.targets.aliased << " aliased";
+        }
+        std::cout << std::endl;
+    }
+
+    if (writeJson(options.outputPath.c_str(), options, results)) {
+        std::cout << "Wrote " << options.outputPath << std::endl;
+    } else {
+        std::cerr << "Could not write " << options.outputPath << std::endl;
+        ok = false;
+    }
+
+    if (surface) surface.release();
+    instance.release();
+    if (window) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+    return ok ? 0 : 1;
+}
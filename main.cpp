@@ -1,11 +1,21 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 #include <GLFW/glfw3.h> // Native Window
 #include <webgpu/webgpu.h>
-#define WEBGPU_CPP_IMPLEMENTATION
 #include <webgpu/webgpu.hpp>
 #include <glfw3webgpu.h>
+#include "FramePacing.h"
+#include "RedrawScheduler.h"
+#include "RenderThread.h"
+#include "FrameProfiler.h"
+#include "FrameCapture.h"
+#include "JobSystem.h"
+#include "Clock.h"
 
 using namespace wgpu;
 
@@ -54,7 +64,160 @@ Device requestDevice(Adapter adapter, DeviceDescriptor const * descriptor) {
     return userData.device;
 }
 
-int main (int, char**) {
+RenderSettings parseOptions(int argc, char** argv) {
+    RenderSettings options;
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        if (strcmp(argv[i], "--pacing") == 0) { // latency|power|<fps>
+            if (strcmp(value, "latency") == 0) {
+                options.pacing.policy = PacingPolicy::LowestLatency;
+            } else if (strcmp(value, "power") == 0) {
+                options.pacing.policy = PacingPolicy::LowestPower;
+            } else if (atof(value) > 0.0) {
+                options.pacing.policy    = PacingPolicy::TargetFps;
+                options.pacing.targetFps = atof(value);
+            } else {
+                std::cerr << "Unknown pacing '" << value << "', expected latency, power or a frame rate" << std::endl;
+            }
+        } else if (strcmp(argv[i], "--redraw") == 0) { // continuous|on-demand
+            if (strcmp(value, "continuous") == 0) {
+                options.redraw = RedrawMode::Continuous;
+            } else if (strcmp(value, "on-demand") == 0) {
+                options.redraw = RedrawMode::OnDemand;
+            } else {
+                std::cerr << "Unknown redraw mode '" << value << "', expected continuous or on-demand" << std::endl;
+            }
+        } else if (strcmp(argv[i], "--trace") == 0) { // <path.json>
+            options.tracePath = value;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0) { // <count>, headless only
+            options.headlessFrames = (uint32_t)std::max(1, atoi(value));
+        } else if (strcmp(argv[i], "--capture") == 0) { // <path prefix>, headless only
+            options.capturePrefix = value;
+        } else if (strcmp(argv[i], "--cpu") == 0) { // Software adapter
+            options.forceFallbackAdapter = true;
+        }
+    }
+    return options;
+}
+
+// State shared with the GLFW callbacks through the window user pointer, main thread only
+struct EventContext {
+    RenderThread* renderThread = nullptr;
+    AppState state;
+};
+
+void postInput(GLFWwindow* window, const InputMessage& message) {
+    static_cast<EventContext*>(glfwGetWindowUserPointer(window))->renderThread->post(message);
+}
+
+void installCallbacks(GLFWwindow* window, EventContext* context) {
+    glfwSetWindowUserPointer(window, context);
+    glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int, int action, int mods) {
+        EventContext& context = *static_cast<EventContext*>(glfwGetWindowUserPointer(window));
+        if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) context.state.pulsing = !context.state.pulsing;
+        InputMessage message;
+        message.type   = InputMessage::Type::Key;
+        message.code   = key;
+        message.action = action;
+        message.mods   = mods;
+        context.renderThread->post(message);
+    });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
+        InputMessage message;
+        message.type   = InputMessage::Type::MouseButton;
+        message.code   = button;
+        message.action = action;
+        message.mods   = mods;
+        postInput(window, message);
+    });
+    glfwSetCursorPosCallback(window, [](GLFWwindow* window, double x, double y) {
+        EventContext& context = *static_cast<EventContext*>(glfwGetWindowUserPointer(window));
+        context.state.cursorX = x;
+        context.state.cursorY = y;
+        InputMessage message;
+        message.type = InputMessage::Type::CursorPos;
+        message.x    = x;
+        message.y    = y;
+        context.renderThread->post(message);
+    });
+    glfwSetScrollCallback(window, [](GLFWwindow* window, double x, double y) {
+        InputMessage message;
+        message.type = InputMessage::Type::Scroll;
+        message.x    = x;
+        message.y    = y;
+        postInput(window, message);
+    });
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) {
+        EventContext& context = *static_cast<EventContext*>(glfwGetWindowUserPointer(window));
+        context.state.width  = width;
+        context.state.height = height;
+        InputMessage message;
+        message.type   = InputMessage::Type::Resize;
+        message.code   = width;
+        message.action = height;
+        context.renderThread->post(message);
+    });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow* window) {
+        postInput(window, InputMessage());
+    });
+}
+
+// Renders a fixed number of frames into an offscreen target without GLFW or a window, for CI
+// and benchmarking machines without a display. Animation time advances by a fixed 60 Hz step
+// per frame so that every run renders the same frames.
+int runHeadless(const RenderSettings& options) {
+    Clock::useGlfw(false);
+
+    InstanceDescriptor desc = {};
+    desc.nextInChain = nullptr;
+    Instance instance = createInstance(desc);
+    if (!instance) {
+        std::cerr << "Could not initialize WebGPU!" << std::endl;
+        return 1;
+    }
+
+    RendererConfig config;
+    config.forceFallbackAdapter = options.forceFallbackAdapter;
+    config.capturePrefix        = options.capturePrefix;
+    Renderer renderer;
+    if (!renderer.initialize(instance, nullptr, config)) {
+        std::cerr << "Could not initialize the renderer!" << std::endl;
+        instance.release();
+        return 1;
+    }
+
+    FrameState frame;
+    double start = Clock::seconds();
+    for (uint32_t i = 0; i < options.headlessFrames; i++) {
+        frame.pulseTime = i / 60.0;
+        renderer.renderFrame(frame);
+    }
+    renderer.waitIdle();
+    double elapsed = Clock::seconds() - start;
+
+    std::cout << "Rendered " << options.headlessFrames << " headless frames (" << renderer.width() << "x" << renderer.height()
+              << ") in " << elapsed << " s, " << options.headlessFrames / elapsed << " fps, "
+              << 1e3 * elapsed / options.headlessFrames << " ms per frame" << std::endl;
+    if (FrameCapture* capture = renderer.capture()) {
+        std::cout << "Captured " << capture->writtenCount() << " frames, skipped " << capture->skippedCount()
+                  << ", failed " << capture->failedCount() << std::endl;
+    }
+    renderer.profiler()->printSummary(std::cout);
+    if (!options.tracePath.empty() && !renderer.profiler()->exportChromeTrace(options.tracePath.c_str())) {
+        std::cerr << "Could not write frame trace to " << options.tracePath << std::endl;
+    }
+
+    renderer.terminate();
+    instance.release();
+    return 0;
+}
+
+int main (int argc, char** argv) {
+    RenderSettings options = parseOptions(argc, argv);
+    if (options.headless) return runHeadless(options);
+
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return 1;
@@ -64,7 +227,7 @@ int main (int, char**) {
     int h = 600;
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE); // The render thread recreates the swap chain
     GLFWwindow* window = glfwCreateWindow(w, h, "WebGPU", NULL, NULL);
     if (!window) {
         std::cerr << "Failed to create window" << std::endl;
@@ -77,161 +240,50 @@ int main (int, char**) {
     Instance instance = createInstance(desc);
     if (!instance) {
         std::cerr << "Could not initialize WebGPU!" << std::endl;
+        glfwTerminate();
         return 1;
     }
 
     Surface surface = glfwGetWGPUSurface(instance, window);
 
-    RequestAdapterOptions adapterOpts = {};
-    adapterOpts.nextInChain       = nullptr;
-    adapterOpts.compatibleSurface = surface;
-    Adapter adapter = instance.requestAdapter(adapterOpts);
-
-    DeviceDescriptor deviceDesc = {};
-    deviceDesc.nextInChain              = nullptr;
-    deviceDesc.label                    = "Device";
-    deviceDesc.requiredFeaturesCount    = 0;
-    deviceDesc.requiredLimits           = nullptr;
-    deviceDesc.defaultQueue.nextInChain = nullptr;
-    deviceDesc.defaultQueue.label       = "Default Queue";
-    Device device = adapter.requestDevice(deviceDesc);
-    device.setUncapturedErrorCallback([](WGPUErrorType type, char const* message) {
-        std::cout << "Uncaptured device error: type " << type;
-        if (message) std::cout << " (" << message << ")";
-        std::cout << std::endl;
-    });
-
-    Queue queue = device.getQueue();
-
-    TextureFormat swapChainFormat = surface.getPreferredFormat(adapter);
-    SwapChainDescriptor swapChainDesc = {};
-    swapChainDesc.nextInChain = nullptr;
-    swapChainDesc.width       = w;
-    swapChainDesc.height      = h;
-    swapChainDesc.format      = swapChainFormat;
-    swapChainDesc.usage       = WGPUTextureUsage_RenderAttachment;
-    swapChainDesc.presentMode = WGPUPresentMode_Immediate;
-    SwapChain swapChain = device.createSwapChain(surface, swapChainDesc);
-
-    const char* shaderSource = R"(
-        @vertex
-        fn vs_main(@builtin(vertex_index) in_vertex_index: u32) -> @builtin(position) vec4f {
-            var p = vec2f(0.0, 0.0);
-            if (in_vertex_index == 0u) {
-                p = vec2f(-0.5, -0.5);
-            } else if (in_vertex_index == 1u) {
-                p = vec2f(0.5, -0.5);
-            } else {
-                p = vec2f(0.0, 0.5);
-            }
-            return vec4f(p, 0.0, 1.0);
-        }
+    // Background pulse, Space toggles it. Dashboards (on-demand) start static.
+    EventContext context;
+    glfwGetFramebufferSize(window, &context.state.width, &context.state.height);
+    context.state.pulsing = options.redraw == RedrawMode::Continuous;
+
+    // Shared by the renderer and the app, jobs that must run on the main thread (e.g. GLFW calls)
+    // are run by the event loop, which an empty event wakes up
+    JobSystem jobs;
+    jobs.setMainThreadWakeUp([]() { glfwPostEmptyEvent(); });
+    RenderThread renderThread(options, &jobs);
+    context.renderThread = &renderThread;
+    if (!renderThread.start(instance, surface, context.state)) {
+        std::cerr << "Could not initialize the renderer!" << std::endl;
+        jobs.pumpMainThread(); // The same shutdown as below, the render thread has already exited
+        surface.release();
+        instance.release();
+        glfwTerminate();
+        return 1;
+    }
+    installCallbacks(window, &context);
 
-        @fragment
-        fn fs_main() -> @location(0) vec4f {
-            return vec4f(1.0, 0.0, 0.0, 1.0);
-        }
-    )";
-
-    ShaderModuleWGSLDescriptor shaderCodeDesc;
-    shaderCodeDesc.chain.next  = nullptr;
-    shaderCodeDesc.chain.sType = SType::ShaderModuleWGSLDescriptor;
-    shaderCodeDesc.code = shaderSource;
-
-    ShaderModuleDescriptor shaderDesc;
-#ifdef WEBGPU_BACKEND_WGPU
-    shaderDesc.hintCount = 0;
-    shaderDesc.hints = nullptr;
-#endif
-    shaderDesc.nextInChain = &shaderCodeDesc.chain;
-    ShaderModule shaderModule = device.createShaderModule(shaderDesc);
-
-    BlendState blendState;
-    blendState.color.srcFactor = BlendFactor::SrcAlpha;
-    blendState.color.dstFactor = BlendFactor::OneMinusSrcAlpha;
-    blendState.color.operation = BlendOperation::Add;
-
-    ColorTargetState colorTarget;
-    colorTarget.format    = swapChainFormat;
-    colorTarget.blend     = &blendState;
-    colorTarget.writeMask = ColorWriteMask::All;
-
-    FragmentState fragmentState;
-    fragmentState.module        = shaderModule;
-    fragmentState.entryPoint    = "fs_main";
-    fragmentState.constantCount = 0;
-    fragmentState.constants     = nullptr;
-    fragmentState.targetCount   = 1;
-    fragmentState.targets       = &colorTarget;
-
-    RenderPipelineDescriptor pipelineDesc;
-    pipelineDesc.vertex.bufferCount   = 0;
-    pipelineDesc.vertex.buffers       = nullptr;
-    pipelineDesc.vertex.module        = shaderModule;
-    pipelineDesc.vertex.entryPoint    = "vs_main";
-    pipelineDesc.vertex.constantCount = 0;
-    pipelineDesc.vertex.constants     = nullptr;
-    pipelineDesc.primitive.topology   = PrimitiveTopology::TriangleList;
-    pipelineDesc.primitive.stripIndexFormat = IndexFormat::Undefined;
-    pipelineDesc.primitive.frontFace  = FrontFace::CCW;
-    pipelineDesc.primitive.cullMode   = CullMode::None;
-    pipelineDesc.multisample.count    = 1;
-    pipelineDesc.multisample.mask     = ~0u; // Default value for the mask, meaning "all bits on"
-    pipelineDesc.multisample.alphaToCoverageEnabled = false;
-    pipelineDesc.layout               = nullptr;
-    pipelineDesc.fragment             = &fragmentState;
-    pipelineDesc.depthStencil         = nullptr;
-    RenderPipeline pipeline = device.createRenderPipeline(pipelineDesc);
-
-    CommandEncoderDescriptor encoderDesc = {};
-    encoderDesc.nextInChain = nullptr;
-    encoderDesc.label       = "Command Encoder";
-
-    RenderPassColorAttachment renderPassColorAttachment = {};
-    renderPassColorAttachment.loadOp  = WGPULoadOp_Clear;
-    renderPassColorAttachment.storeOp = WGPUStoreOp_Store;
-
-    RenderPassDescriptor renderPassDesc = {};
-    renderPassDesc.colorAttachmentCount = 1;
-    renderPassDesc.colorAttachments     = &renderPassColorAttachment;
-
-    CommandBufferDescriptor cmdBufferDescriptor = {};
-    cmdBufferDescriptor.nextInChain = nullptr;
-    cmdBufferDescriptor.label       = "Command buffer";
-
-    int i_frame = 0;
-
-    // Main Loop
+    // Main Loop: only pumps events, rendering never blocks it
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-
-        TextureView RT = swapChain.getCurrentTextureView();
-        CommandEncoder encoder = device.createCommandEncoder(encoderDesc);
-
-        renderPassColorAttachment.view          = RT;
-        renderPassColorAttachment.resolveTarget = nullptr; // For MSAA
-        renderPassColorAttachment.clearValue    = WGPUColor{ 0.0, sin(0.0025 * i_frame), 0.0, 1.0 };
-
-        RenderPassEncoder renderPass = encoder.beginRenderPass(renderPassDesc);
-        renderPass.setPipeline(pipeline);
-        renderPass.draw(3, 1, 0, 0); // Draw triangle
-        renderPass.end();
-        renderPass.release();
-
-        CommandBuffer command = encoder.finish(cmdBufferDescriptor);
-        queue.submit(1, &command);
-        encoder.release();
-        command.release();
-
-        RT.release();
-        swapChain.present();
-        i_frame++;
+        glfwWaitEvents();
+        jobs.pumpMainThread();
+        renderThread.publish(context.state);
+
+        FrameReport report;
+        if (renderThread.pollReport(report)) {
+            char title[128];
+            snprintf(title, sizeof(title), "WebGPU - %.2f ms (variance %.4f ms^2, max %.2f ms)",
+                1e3 * report.mean, 1e6 * report.variance, 1e3 * report.max);
+            glfwSetWindowTitle(window, title);
+        }
     }
 
-    swapChain.release();
-    queue.release();
-    device.release();
-    adapter.release();
+    renderThread.stop();
+    jobs.pumpMainThread(); // Before glfwTerminate(), queued jobs may still use GLFW
     surface.release();
     instance.release();
     glfwTerminate();
@@ -0,0 +1,55 @@
+// Frustum culling for GpuCulling: one invocation per object writes its indexed draw. With
+// params.compact the visible draws are appended and counted in drawCount, for
+// multiDrawIndexedIndirectCount; otherwise every object keeps its slot and culled ones get
+// an instance count of zero.
+
+struct Object {
+    center: vec3f,
+    radius: f32, // Negative for removed objects
+    indexCount: u32,
+    firstIndex: u32,
+    baseVertex: i32,
+    padding: u32,
+}
+
+struct DrawArgs {
+    indexCount: u32,
+    instanceCount: u32,
+    firstIndex: u32,
+    baseVertex: i32,
+    firstInstance: u32,
+}
+
+struct Params {
+    planes: array<vec4f, 6>, // Normalized, pointing inside
+    objectCount: u32,
+    compact: u32,
+}
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read> objects: array<Object>;
+@group(0) @binding(2) var<storage, read_write> draws: array<DrawArgs>;
+@group(0) @binding(3) var<storage, read_write> drawCount: atomic<u32>;
+
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id: vec3u) {
+    let index = id.x;
+    if (index >= params.objectCount) {
+        return;
+    }
+    let object = objects[index];
+    var visible = object.radius >= 0.0;
+    for (var i = 0u; i < 6u; i++) {
+        let plane = params.planes[i];
+        visible = visible && dot(plane.xyz, object.center) + plane.w >= -object.radius;
+    }
+
+    var slot = index;
+    if (params.compact != 0u) {
+        if (!visible) {
+            return;
+        }
+        slot = atomicAdd(&drawCount, 1u);
+    }
+    draws[slot] = DrawArgs(object.indexCount, select(0u, 1u, visible), object.firstIndex, object.baseVertex, index);
+}
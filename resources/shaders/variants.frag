@@ -0,0 +1,14 @@
+#version 450
+// GLSL twin of variants.wgsl's fragment stage, its defines are passed to wgpu-native
+
+layout(location = 0) out vec4 color;
+
+void main() {
+    color = vec4(0.2, 0.2, 0.2, 1.0);
+#ifdef RED
+    color.r = 1.0;
+#endif
+#ifdef BLUE
+    color.b = 1.0;
+#endif
+}
@@ -0,0 +1,16 @@
+#version 450
+// GLSL twin of variants.wgsl's vertex stage, its defines are passed to wgpu-native
+
+void main() {
+    vec2 p = vec2(0.1, 0.1);
+    if (gl_VertexIndex == 1) {
+        p = vec2(0.9, 0.1);
+    } else if (gl_VertexIndex == 2) {
+        p = vec2(0.5, 0.9);
+    }
+#ifdef SHRINK
+    p = 0.5 + (p - 0.5) * 0.5;
+#endif
+    vec2 origin = vec2(float(gl_InstanceIndex % 8), float(gl_InstanceIndex / 8)) * 0.25 - 1.0;
+    gl_Position = vec4(origin + p * 0.25, 0.0, 1.0);
+}
@@ -0,0 +1,29 @@
+// Shader with optional features for ShaderPermutations, each one changes what a draw looks
+// like. Instance i draws a triangle in cell i of an 8x8 grid.
+
+@vertex
+fn vs_main(@builtin(vertex_index) vertex: u32, @builtin(instance_index) instance: u32) -> @builtin(position) vec4f {
+    var p = vec2f(0.1, 0.1);
+    if (vertex == 1u) {
+        p = vec2f(0.9, 0.1);
+    } else if (vertex == 2u) {
+        p = vec2f(0.5, 0.9);
+    }
+#ifdef SHRINK
+    p = 0.5 + (p - 0.5) * 0.5;
+#endif
+    let origin = vec2f(f32(instance % 8u), f32(instance / 8u)) * 0.25 - 1.0;
+    return vec4f(origin + p * 0.25, 0.0, 1.0);
+}
+
+@fragment
+fn fs_main() -> @location(0) vec4f {
+    var color = vec4f(0.2, 0.2, 0.2, 1.0);
+#ifdef RED
+    color.r = 1.0;
+#endif
+#ifdef BLUE
+    color.b = 1.0;
+#endif
+    return color;
+}
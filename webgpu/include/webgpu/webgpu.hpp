@@ -42,6 +42,13 @@
 #include <functional>
 #include <cassert>
 #include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <cstring>
+#include <type_traits>
+#include <cstddef>
+#include <new>
 
 /**
  * A namespace providing a more C++ idiomatic API to WebGPU.
@@ -1106,6 +1113,8 @@ HANDLE(Buffer)
 	uint64_t getSize();
 	BufferUsage getUsage();
 	std::unique_ptr<BufferMapCallback> mapAsync(MapModeFlags mode, size_t offset, size_t size, BufferMapCallback&& callback);
+	template <typename Callback>
+	void mapAsync(MapModeFlags mode, size_t offset, size_t size, Callback&& callback);
 	void setLabel(char const * label);
 	void unmap();
 	void reference();
@@ -1169,11 +1178,15 @@ HANDLE(Device)
 	CommandEncoder createCommandEncoder(const CommandEncoderDescriptor& descriptor);
 	ComputePipeline createComputePipeline(const ComputePipelineDescriptor& descriptor);
 	std::unique_ptr<CreateComputePipelineAsyncCallback> createComputePipelineAsync(const ComputePipelineDescriptor& descriptor, CreateComputePipelineAsyncCallback&& callback);
+	template <typename Callback>
+	void createComputePipelineAsync(const ComputePipelineDescriptor& descriptor, Callback&& callback);
 	PipelineLayout createPipelineLayout(const PipelineLayoutDescriptor& descriptor);
 	QuerySet createQuerySet(const QuerySetDescriptor& descriptor);
 	RenderBundleEncoder createRenderBundleEncoder(const RenderBundleEncoderDescriptor& descriptor);
 	RenderPipeline createRenderPipeline(const RenderPipelineDescriptor& descriptor);
 	std::unique_ptr<CreateRenderPipelineAsyncCallback> createRenderPipelineAsync(const RenderPipelineDescriptor& descriptor, CreateRenderPipelineAsyncCallback&& callback);
+	template <typename Callback>
+	void createRenderPipelineAsync(const RenderPipelineDescriptor& descriptor, Callback&& callback);
 	Sampler createSampler(const SamplerDescriptor& descriptor);
 	ShaderModule createShaderModule(const ShaderModuleDescriptor& descriptor);
 	SwapChain createSwapChain(Surface surface, const SwapChainDescriptor& descriptor);
@@ -1184,11 +1197,14 @@ HANDLE(Device)
 	Queue getQueue();
 	bool hasFeature(FeatureName feature);
 	std::unique_ptr<ErrorCallback> popErrorScope(ErrorCallback&& callback);
+	template <typename Callback>
+	void popErrorScope(Callback&& callback);
 	void pushErrorScope(ErrorFilter filter);
 	void setLabel(char const * label);
 	std::unique_ptr<ErrorCallback> setUncapturedErrorCallback(ErrorCallback&& callback);
 	void reference();
 	void release();
+	bool poll(bool wait, WrappedSubmissionIndex const * wrappedSubmissionIndex);
 END
 
 HANDLE(Instance)
@@ -1217,6 +1233,8 @@ END
 
 HANDLE(Queue)
 	std::unique_ptr<QueueWorkDoneCallback> onSubmittedWorkDone(QueueWorkDoneCallback&& callback);
+	template <typename Callback>
+	void onSubmittedWorkDone(Callback&& callback);
 	void setLabel(char const * label);
 	void submit(uint32_t commandCount, CommandBuffer const * commands);
 	void submit(const std::vector<WGPUCommandBuffer>& commands);
@@ -1225,6 +1243,9 @@ HANDLE(Queue)
 	void writeTexture(const ImageCopyTexture& destination, void const * data, size_t dataSize, const TextureDataLayout& dataLayout, const Extent3D& writeSize);
 	void reference();
 	void release();
+	SubmissionIndex submitForIndex(uint32_t commandCount, CommandBuffer const * commands);
+	SubmissionIndex submitForIndex(const std::vector<WGPUCommandBuffer>& commands);
+	SubmissionIndex submitForIndex(const WGPUCommandBuffer& commands);
 END
 
 HANDLE(RenderBundle)
@@ -1307,6 +1328,7 @@ HANDLE(Surface)
 	TextureFormat getPreferredFormat(Adapter adapter);
 	void reference();
 	void release();
+	void getCapabilities(Adapter adapter, SurfaceCapabilities * capabilities);
 END
 
 HANDLE(SwapChain)
@@ -1339,6 +1361,303 @@ HANDLE(TextureView)
 END
 
 
+// Ownership helpers
+
+/**
+ * Move-only owner of a handle, which it releases when destroyed or reset. It adopts the
+ * reference returned by create*()/get*() calls, so no reference() is needed. Everything is
+ * inline and it has the size of the raw handle, so it compiles to the same code as manual
+ * release() calls.
+ */
+template <typename Handle>
+class UniqueHandle {
+public:
+	typedef typename Handle::W W;
+	UniqueHandle() : m_handle(nullptr) {}
+	UniqueHandle(std::nullptr_t) : m_handle(nullptr) {}
+	explicit UniqueHandle(Handle handle) : m_handle(handle) {}
+	~UniqueHandle() { if (m_handle) m_handle.release(); }
+	UniqueHandle(UniqueHandle&& other) noexcept : m_handle(other.detach()) {}
+	UniqueHandle& operator=(UniqueHandle&& other) noexcept { reset(other.detach()); return *this; }
+	UniqueHandle(const UniqueHandle&) = delete;
+	UniqueHandle& operator=(const UniqueHandle&) = delete;
+
+	// Handles are pointers, constness of the owner does not extend to the object
+	Handle get() const { return m_handle; }
+	Handle& operator*() const { return m_handle; }
+	Handle* operator->() const { return &m_handle; }
+	operator Handle() const { return m_handle; }
+	operator W() const { return m_handle; }
+	explicit operator bool() const { return m_handle != nullptr; }
+
+	// Gives up ownership without releasing
+	Handle detach() { Handle handle = m_handle; m_handle = nullptr; return handle; }
+	void reset(Handle handle = nullptr) {
+		Handle old = m_handle;
+		m_handle = handle;
+		if (old) old.release();
+	}
+
+private:
+	mutable Handle m_handle;
+};
+
+/**
+ * Reference counted owner of a handle: copies call reference(), destruction calls release().
+ * The constructor adopts a reference like UniqueHandle, use retain() to share a handle owned
+ * by someone else.
+ */
+template <typename Handle>
+class SharedHandle {
+public:
+	typedef typename Handle::W W;
+	SharedHandle() : m_handle(nullptr) {}
+	SharedHandle(std::nullptr_t) : m_handle(nullptr) {}
+	explicit SharedHandle(Handle handle) : m_handle(handle) {}
+	SharedHandle(UniqueHandle<Handle>&& unique) : m_handle(unique.detach()) {}
+	static SharedHandle retain(Handle handle) { if (handle) handle.reference(); return SharedHandle(handle); }
+	~SharedHandle() { if (m_handle) m_handle.release(); }
+	SharedHandle(const SharedHandle& other) : m_handle(other.m_handle) { if (m_handle) m_handle.reference(); }
+	SharedHandle(SharedHandle&& other) noexcept : m_handle(other.detach()) {}
+	SharedHandle& operator=(const SharedHandle& other) { reset(retain(other.m_handle).detach()); return *this; }
+	SharedHandle& operator=(SharedHandle&& other) noexcept { reset(other.detach()); return *this; }
+
+	Handle get() const { return m_handle; }
+	Handle& operator*() const { return m_handle; }
+	Handle* operator->() const { return &m_handle; }
+	operator Handle() const { return m_handle; }
+	operator W() const { return m_handle; }
+	explicit operator bool() const { return m_handle != nullptr; }
+
+	Handle detach() { Handle handle = m_handle; m_handle = nullptr; return handle; }
+	void reset(Handle handle = nullptr) {
+		Handle old = m_handle;
+		m_handle = handle;
+		if (old) old.release();
+	}
+
+private:
+	mutable Handle m_handle;
+};
+
+static_assert(sizeof(UniqueHandle<Buffer>) == sizeof(WGPUBuffer), "UniqueHandle must be as small as the raw handle");
+static_assert(sizeof(SharedHandle<Buffer>) == sizeof(WGPUBuffer), "SharedHandle must be as small as the raw handle");
+
+
+// Synchronization helpers
+
+/**
+ * A CPU-side timeline over wgpu-native submission indices.
+ * signal() submits work and returns the value the fence reaches once that work has
+ * retired on the GPU. Objects handed to releaseAfter()/destroyAfter() are kept alive
+ * until the fence reaches the given value, then released by collect().
+ */
+class Fence {
+public:
+	Fence(Device device, Queue queue);
+	~Fence();
+	Fence(const Fence&) = delete;
+	Fence& operator=(const Fence&) = delete;
+
+	SubmissionIndex signal(uint32_t commandCount, CommandBuffer const * commands);
+	SubmissionIndex signal(const WGPUCommandBuffer& commands);
+	SubmissionIndex lastSignaled() const { return m_signaled; }
+	// Never blocks, polls the device once to pick up retired submissions
+	SubmissionIndex completedValue();
+	bool isComplete(SubmissionIndex value);
+	// Returns false if the timeout expired before the fence reached value
+	bool wait(SubmissionIndex value, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+	void waitIdle() { wait(m_signaled); }
+
+	template <typename Handle>
+	void releaseAfter(SubmissionIndex value, Handle handle);
+	template <typename Handle>
+	void destroyAfter(SubmissionIndex value, Handle handle);
+	template <typename Handle>
+	void releaseAfter(SubmissionIndex value, UniqueHandle<Handle>&& handle) { releaseAfter(value, handle.detach()); }
+	template <typename Handle>
+	void destroyAfter(SubmissionIndex value, UniqueHandle<Handle>&& handle) { destroyAfter(value, handle.detach()); }
+	// Runs the deferred releases whose submission has retired
+	void collect();
+
+	Device getDevice() const { return m_device; }
+	Queue getQueue() const { return m_queue; }
+
+private:
+	struct Deferred {
+		SubmissionIndex value;
+		void * raw;
+		void (*release)(void * raw);
+	};
+	void defer(SubmissionIndex value, void * raw, void (*release)(void * raw));
+	static void onWorkDone(WGPUQueueWorkDoneStatus status, void * userdata);
+
+	SharedHandle<Device> m_device;
+	SharedHandle<Queue> m_queue;
+	SubmissionIndex m_signaled = 0;
+	SubmissionIndex m_completed = 0;
+	std::vector<SubmissionIndex> m_pending; // FIFO of signaled values awaiting their work-done callback
+	size_t m_pendingHead = 0;
+	std::vector<Deferred> m_deferred;
+};
+
+template <typename Handle>
+void Fence::releaseAfter(SubmissionIndex value, Handle handle) {
+	if (!handle) return;
+	defer(value, static_cast<void*>(static_cast<typename Handle::W>(handle)), [](void * raw) {
+		Handle(static_cast<typename Handle::W>(raw)).release();
+	});
+}
+template <typename Handle>
+void Fence::destroyAfter(SubmissionIndex value, Handle handle) {
+	if (!handle) return;
+	defer(value, static_cast<void*>(static_cast<typename Handle::W>(handle)), [](void * raw) {
+		Handle object(static_cast<typename Handle::W>(raw));
+		object.destroy();
+		object.release();
+	});
+}
+
+
+// Allocation-free callbacks
+
+/**
+ * The templated overloads of the one-shot async calls (mapAsync, create*PipelineAsync,
+ * popErrorScope, onSubmittedWorkDone) take any callable without wrapping it in a
+ * std::function, and without the returned handle that must outlive the call: the callback
+ * owns itself until it has run once.
+ * Callables that fit in a pointer and are trivially copyable (a lambda capturing one pointer
+ * or nothing) travel inline in the C userdata. Bigger ones are moved into a block of a
+ * per-size-class pool, which only allocates when it grows, so steady state never touches
+ * the allocator.
+ */
+namespace detail {
+
+template <size_t BlockSize>
+class CallbackPool {
+public:
+	static void * acquire() {
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (!state.free) {
+			state.chunks.push_back(std::make_unique<Block[]>(kChunkSize));
+			Block * chunk = state.chunks.back().get();
+			for (size_t i = 0; i < kChunkSize; ++i) {
+				chunk[i].next = state.free;
+				state.free = &chunk[i];
+			}
+		}
+		Block * block = state.free;
+		state.free = block->next;
+		return block->storage;
+	}
+	static void release(void * storage) {
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		Block * block = reinterpret_cast<Block*>(storage);
+		block->next = state.free;
+		state.free = block;
+	}
+
+private:
+	static constexpr size_t kChunkSize = 64;
+	union Block {
+		Block * next;
+		alignas(std::max_align_t) unsigned char storage[BlockSize];
+	};
+	struct State {
+		std::mutex mutex;
+		Block * free = nullptr;
+		std::vector<std::unique_ptr<Block[]>> chunks;
+	};
+	static State& getState() {
+		static State state;
+		return state;
+	}
+};
+
+template <typename F>
+constexpr bool isInlineCallback = sizeof(F) <= sizeof(void*) && std::is_trivially_copyable<F>::value && std::is_trivially_destructible<F>::value;
+
+template <typename F>
+constexpr size_t callbackBlockSize = sizeof(F) <= 64 ? 64 : sizeof(F) <= 256 ? 256 : 1024;
+
+// Packs the callable into a userdata pointer
+template <typename F>
+void * storeCallback(F&& callback) {
+	using Fn = typename std::decay<F>::type;
+	if constexpr (isInlineCallback<Fn>) {
+		void * userdata = nullptr;
+		std::memcpy(&userdata, &callback, sizeof(Fn));
+		return userdata;
+	} else {
+		static_assert(sizeof(Fn) <= 1024, "Callback captures more than 1 KiB, capture a pointer to the state instead");
+		static_assert(alignof(Fn) <= alignof(std::max_align_t), "Over-aligned callback");
+		void * storage = CallbackPool<callbackBlockSize<Fn>>::acquire();
+		new (storage) Fn(std::forward<F>(callback));
+		return storage;
+	}
+}
+
+// Unpacks the callable stored by storeCallback<Fn>, runs it and frees its block
+template <typename Fn, typename... Args>
+void invokeCallback(void * userdata, Args&&... args) {
+	if constexpr (isInlineCallback<Fn>) {
+		alignas(Fn) unsigned char storage[sizeof(Fn)];
+		std::memcpy(storage, &userdata, sizeof(Fn));
+		(*reinterpret_cast<Fn*>(storage))(std::forward<Args>(args)...);
+	} else {
+		Fn * callback = static_cast<Fn*>(userdata);
+		(*callback)(std::forward<Args>(args)...);
+		callback->~Fn();
+		CallbackPool<callbackBlockSize<Fn>>::release(userdata);
+	}
+}
+
+} // namespace detail
+
+template <typename Callback>
+void Buffer::mapAsync(MapModeFlags mode, size_t offset, size_t size, Callback&& callback) {
+	using Fn = typename std::decay<Callback>::type;
+	void * userdata = detail::storeCallback(std::forward<Callback>(callback));
+	wgpuBufferMapAsync(m_raw, mode, offset, size, [](WGPUBufferMapAsyncStatus status, void * userdata) {
+		detail::invokeCallback<Fn>(userdata, static_cast<BufferMapAsyncStatus>(status));
+	}, userdata);
+}
+template <typename Callback>
+void Device::createRenderPipelineAsync(const RenderPipelineDescriptor& descriptor, Callback&& callback) {
+	using Fn = typename std::decay<Callback>::type;
+	void * userdata = detail::storeCallback(std::forward<Callback>(callback));
+	wgpuDeviceCreateRenderPipelineAsync(m_raw, &descriptor, [](WGPUCreatePipelineAsyncStatus status, WGPURenderPipeline pipeline, char const * message, void * userdata) {
+		detail::invokeCallback<Fn>(userdata, static_cast<CreatePipelineAsyncStatus>(status), RenderPipeline(pipeline), message);
+	}, userdata);
+}
+template <typename Callback>
+void Device::createComputePipelineAsync(const ComputePipelineDescriptor& descriptor, Callback&& callback) {
+	using Fn = typename std::decay<Callback>::type;
+	void * userdata = detail::storeCallback(std::forward<Callback>(callback));
+	wgpuDeviceCreateComputePipelineAsync(m_raw, &descriptor, [](WGPUCreatePipelineAsyncStatus status, WGPUComputePipeline pipeline, char const * message, void * userdata) {
+		detail::invokeCallback<Fn>(userdata, static_cast<CreatePipelineAsyncStatus>(status), ComputePipeline(pipeline), message);
+	}, userdata);
+}
+template <typename Callback>
+void Device::popErrorScope(Callback&& callback) {
+	using Fn = typename std::decay<Callback>::type;
+	void * userdata = detail::storeCallback(std::forward<Callback>(callback));
+	wgpuDevicePopErrorScope(m_raw, [](WGPUErrorType type, char const * message, void * userdata) {
+		detail::invokeCallback<Fn>(userdata, static_cast<ErrorType>(type), message);
+	}, userdata);
+}
+template <typename Callback>
+void Queue::onSubmittedWorkDone(Callback&& callback) {
+	using Fn = typename std::decay<Callback>::type;
+	void * userdata = detail::storeCallback(std::forward<Callback>(callback));
+	wgpuQueueOnSubmittedWorkDone(m_raw, [](WGPUQueueWorkDoneStatus status, void * userdata) {
+		detail::invokeCallback<Fn>(userdata, static_cast<QueueWorkDoneStatus>(status));
+	}, userdata);
+}
+
+
 // Non-member procedures
 
 
@@ -1912,7 +2231,7 @@ bool Adapter::hasFeature(FeatureName feature) {
 	return wgpuAdapterHasFeature(m_raw, static_cast<WGPUFeatureName>(feature));
 }
 std::unique_ptr<RequestDeviceCallback> Adapter::requestDevice(const DeviceDescriptor& descriptor, RequestDeviceCallback&& callback) {
-	auto handle = std::make_unique<RequestDeviceCallback>(callback);
+	auto handle = std::make_unique<RequestDeviceCallback>(std::move(callback));
 	static auto cCallback = [](WGPURequestDeviceStatus status, WGPUDevice device, char const * message, void * userdata) -> void {
 		RequestDeviceCallback& callback = *reinterpret_cast<RequestDeviceCallback*>(userdata);
 		callback(static_cast<RequestDeviceStatus>(status), device, message);
@@ -1972,7 +2291,7 @@ BufferUsage Buffer::getUsage() {
 	return static_cast<BufferUsage>(wgpuBufferGetUsage(m_raw));
 }
 std::unique_ptr<BufferMapCallback> Buffer::mapAsync(MapModeFlags mode, size_t offset, size_t size, BufferMapCallback&& callback) {
-	auto handle = std::make_unique<BufferMapCallback>(callback);
+	auto handle = std::make_unique<BufferMapCallback>(std::move(callback));
 	static auto cCallback = [](WGPUBufferMapAsyncStatus status, void * userdata) -> void {
 		BufferMapCallback& callback = *reinterpret_cast<BufferMapCallback*>(userdata);
 		callback(static_cast<BufferMapAsyncStatus>(status));
@@ -2137,7 +2456,7 @@ ComputePipeline Device::createComputePipeline(const ComputePipelineDescriptor& d
 	return wgpuDeviceCreateComputePipeline(m_raw, &descriptor);
 }
 std::unique_ptr<CreateComputePipelineAsyncCallback> Device::createComputePipelineAsync(const ComputePipelineDescriptor& descriptor, CreateComputePipelineAsyncCallback&& callback) {
-	auto handle = std::make_unique<CreateComputePipelineAsyncCallback>(callback);
+	auto handle = std::make_unique<CreateComputePipelineAsyncCallback>(std::move(callback));
 	static auto cCallback = [](WGPUCreatePipelineAsyncStatus status, WGPUComputePipeline pipeline, char const * message, void * userdata) -> void {
 		CreateComputePipelineAsyncCallback& callback = *reinterpret_cast<CreateComputePipelineAsyncCallback*>(userdata);
 		callback(static_cast<CreatePipelineAsyncStatus>(status), pipeline, message);
@@ -2158,7 +2477,7 @@ RenderPipeline Device::createRenderPipeline(const RenderPipelineDescriptor& desc
 	return wgpuDeviceCreateRenderPipeline(m_raw, &descriptor);
 }
 std::unique_ptr<CreateRenderPipelineAsyncCallback> Device::createRenderPipelineAsync(const RenderPipelineDescriptor& descriptor, CreateRenderPipelineAsyncCallback&& callback) {
-	auto handle = std::make_unique<CreateRenderPipelineAsyncCallback>(callback);
+	auto handle = std::make_unique<CreateRenderPipelineAsyncCallback>(std::move(callback));
 	static auto cCallback = [](WGPUCreatePipelineAsyncStatus status, WGPURenderPipeline pipeline, char const * message, void * userdata) -> void {
 		CreateRenderPipelineAsyncCallback& callback = *reinterpret_cast<CreateRenderPipelineAsyncCallback*>(userdata);
 		callback(static_cast<CreatePipelineAsyncStatus>(status), pipeline, message);
@@ -2194,7 +2513,7 @@ bool Device::hasFeature(FeatureName feature) {
 	return wgpuDeviceHasFeature(m_raw, static_cast<WGPUFeatureName>(feature));
 }
 std::unique_ptr<ErrorCallback> Device::popErrorScope(ErrorCallback&& callback) {
-	auto handle = std::make_unique<ErrorCallback>(callback);
+	auto handle = std::make_unique<ErrorCallback>(std::move(callback));
 	static auto cCallback = [](WGPUErrorType type, char const * message, void * userdata) -> void {
 		ErrorCallback& callback = *reinterpret_cast<ErrorCallback*>(userdata);
 		callback(static_cast<ErrorType>(type), message);
@@ -2209,7 +2528,7 @@ void Device::setLabel(char const * label) {
 	return wgpuDeviceSetLabel(m_raw, label);
 }
 std::unique_ptr<ErrorCallback> Device::setUncapturedErrorCallback(ErrorCallback&& callback) {
-	auto handle = std::make_unique<ErrorCallback>(callback);
+	auto handle = std::make_unique<ErrorCallback>(std::move(callback));
 	static auto cCallback = [](WGPUErrorType type, char const * message, void * userdata) -> void {
 		ErrorCallback& callback = *reinterpret_cast<ErrorCallback*>(userdata);
 		callback(static_cast<ErrorType>(type), message);
@@ -2223,6 +2542,9 @@ void Device::reference() {
 void Device::release() {
 	return wgpuDeviceRelease(m_raw);
 }
+bool Device::poll(bool wait, WrappedSubmissionIndex const * wrappedSubmissionIndex) {
+	return wgpuDevicePoll(m_raw, wait, wrappedSubmissionIndex);
+}
 
 
 // Methods of Instance
@@ -2233,7 +2555,7 @@ void Instance::processEvents() {
 	return wgpuInstanceProcessEvents(m_raw);
 }
 std::unique_ptr<RequestAdapterCallback> Instance::requestAdapter(const RequestAdapterOptions& options, RequestAdapterCallback&& callback) {
-	auto handle = std::make_unique<RequestAdapterCallback>(callback);
+	auto handle = std::make_unique<RequestAdapterCallback>(std::move(callback));
 	static auto cCallback = [](WGPURequestAdapterStatus status, WGPUAdapter adapter, char const * message, void * userdata) -> void {
 		RequestAdapterCallback& callback = *reinterpret_cast<RequestAdapterCallback*>(userdata);
 		callback(static_cast<RequestAdapterStatus>(status), adapter, message);
@@ -2284,7 +2606,7 @@ void QuerySet::release() {
 
 // Methods of Queue
 std::unique_ptr<QueueWorkDoneCallback> Queue::onSubmittedWorkDone(QueueWorkDoneCallback&& callback) {
-	auto handle = std::make_unique<QueueWorkDoneCallback>(callback);
+	auto handle = std::make_unique<QueueWorkDoneCallback>(std::move(callback));
 	static auto cCallback = [](WGPUQueueWorkDoneStatus status, void * userdata) -> void {
 		QueueWorkDoneCallback& callback = *reinterpret_cast<QueueWorkDoneCallback*>(userdata);
 		callback(static_cast<QueueWorkDoneStatus>(status));
@@ -2316,6 +2638,15 @@ void Queue::reference() {
 void Queue::release() {
 	return wgpuQueueRelease(m_raw);
 }
+SubmissionIndex Queue::submitForIndex(uint32_t commandCount, CommandBuffer const * commands) {
+	return wgpuQueueSubmitForIndex(m_raw, commandCount, reinterpret_cast<WGPUCommandBuffer const *>(commands));
+}
+SubmissionIndex Queue::submitForIndex(const std::vector<WGPUCommandBuffer>& commands) {
+	return wgpuQueueSubmitForIndex(m_raw, static_cast<uint32_t>(commands.size()), commands.data());
+}
+SubmissionIndex Queue::submitForIndex(const WGPUCommandBuffer& commands) {
+	return wgpuQueueSubmitForIndex(m_raw, 1, &commands);
+}
 
 
 // Methods of RenderBundle
@@ -2497,7 +2828,7 @@ void Sampler::release() {
 
 // Methods of ShaderModule
 std::unique_ptr<CompilationInfoCallback> ShaderModule::getCompilationInfo(CompilationInfoCallback&& callback) {
-	auto handle = std::make_unique<CompilationInfoCallback>(callback);
+	auto handle = std::make_unique<CompilationInfoCallback>(std::move(callback));
 	static auto cCallback = [](WGPUCompilationInfoRequestStatus status, struct WGPUCompilationInfo const * compilationInfo, void * userdata) -> void {
 		CompilationInfoCallback& callback = *reinterpret_cast<CompilationInfoCallback*>(userdata);
 		callback(static_cast<CompilationInfoRequestStatus>(status), *reinterpret_cast<CompilationInfo const *>(compilationInfo));
@@ -2526,6 +2857,9 @@ void Surface::reference() {
 void Surface::release() {
 	return wgpuSurfaceRelease(m_raw);
 }
+void Surface::getCapabilities(Adapter adapter, SurfaceCapabilities * capabilities) {
+	return wgpuSurfaceGetCapabilities(m_raw, adapter, capabilities);
+}
 
 
 // Methods of SwapChain
@@ -2598,6 +2932,84 @@ void TextureView::release() {
 
 
 
+// Methods of Fence
+Fence::Fence(Device device, Queue queue)
+	: m_device(SharedHandle<Device>::retain(device))
+	, m_queue(SharedHandle<Queue>::retain(queue))
+{}
+Fence::~Fence() {
+	waitIdle();
+	collect();
+}
+SubmissionIndex Fence::signal(uint32_t commandCount, CommandBuffer const * commands) {
+	m_signaled = m_queue->submitForIndex(commandCount, commands);
+	m_pending.push_back(m_signaled);
+	// Work-done callbacks fire in submission order, so each one retires the oldest pending value
+	wgpuQueueOnSubmittedWorkDone(m_queue, onWorkDone, this);
+	return m_signaled;
+}
+SubmissionIndex Fence::signal(const WGPUCommandBuffer& commands) {
+	return signal(1, reinterpret_cast<CommandBuffer const *>(&commands));
+}
+void Fence::onWorkDone(WGPUQueueWorkDoneStatus, void * userdata) {
+	Fence& fence = *reinterpret_cast<Fence*>(userdata);
+	if (fence.m_pendingHead < fence.m_pending.size()) {
+		SubmissionIndex value = fence.m_pending[fence.m_pendingHead++];
+		if (value > fence.m_completed) fence.m_completed = value;
+	}
+	if (fence.m_pendingHead == fence.m_pending.size()) {
+		fence.m_pending.clear();
+		fence.m_pendingHead = 0;
+	}
+}
+SubmissionIndex Fence::completedValue() {
+	if (m_completed < m_signaled && m_device->poll(false, nullptr)) {
+		m_completed = m_signaled; // Queue is empty
+	}
+	return m_completed;
+}
+bool Fence::isComplete(SubmissionIndex value) {
+	return value <= m_completed || value <= completedValue();
+}
+bool Fence::wait(SubmissionIndex value, std::chrono::nanoseconds timeout) {
+	if (isComplete(value)) return true;
+	if (timeout == std::chrono::nanoseconds::max()) {
+		WrappedSubmissionIndex wrapped;
+		wrapped.queue           = m_queue;
+		wrapped.submissionIndex = value;
+		m_device->poll(true, &wrapped);
+		if (value > m_completed) m_completed = value;
+		return true;
+	}
+	// wgpuDevicePoll has no timeout, so spin on non-blocking polls until the deadline
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (!isComplete(value)) {
+		if (std::chrono::steady_clock::now() >= deadline) return false;
+		std::this_thread::yield();
+	}
+	return true;
+}
+void Fence::defer(SubmissionIndex value, void * raw, void (*release)(void * raw)) {
+	if (value <= m_completed) {
+		release(raw);
+		return;
+	}
+	m_deferred.push_back({ value, raw, release });
+}
+void Fence::collect() {
+	SubmissionIndex completed = completedValue();
+	size_t kept = 0;
+	for (size_t i = 0; i < m_deferred.size(); ++i) {
+		if (m_deferred[i].value <= completed) {
+			m_deferred[i].release(m_deferred[i].raw);
+		} else {
+			m_deferred[kept++] = m_deferred[i];
+		}
+	}
+	m_deferred.resize(kept);
+}
+
+
 // Extra implementations
 Adapter Instance::requestAdapter(const RequestAdapterOptions& options) {
 	Adapter adapter = nullptr;